@@ -27,6 +27,7 @@
  *
  */
 
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
@@ -36,12 +37,584 @@
 #include <fcntl.h>
 #include <ctype.h>
 #include <termios.h>
+#include <stdint.h>
+#include <time.h>
+#include <sched.h>
+#include <pthread.h>
 #include <sys/types.h>
 #include <sys/mman.h>
+#include <sys/stat.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
 
 #define FATAL do { fprintf(stderr, "Error at line %d, file %s (%d) [%s]\n", \
   __LINE__, __FILE__, errno, strerror(errno)); exit(1); } while(0)
 
+
+/*
+ * Mapping helpers for the benchmark and sampling modes.
+ *
+ * A mapping source of NULL means /dev/mem; "anon" gives an anonymous mapping;
+ * anything else is treated as a backing file, which is grown if necessary.
+ * The latter two let the benchmark run on hosts without the FPGA bridge.
+ */
+struct mapping {
+    int fd;
+    void *map_base;
+    size_t map_size;
+    void *virt_addr;
+};
+
+static void map_target(struct mapping *m, const char *source, off_t target, size_t span) {
+    long page_size = sysconf(_SC_PAGESIZE);
+    off_t page_mask = page_size - 1;
+    off_t page_base = target & ~page_mask;
+    int flags = MAP_SHARED;
+
+    m->map_size = ((target & page_mask) + span + page_mask) & ~page_mask;
+    m->fd = -1;
+    if(source == NULL) {
+        if((m->fd = open("/dev/mem", O_RDWR | O_SYNC)) == -1) FATAL;
+    } else if(strcmp(source, "anon") == 0) {
+        flags = MAP_PRIVATE | MAP_ANONYMOUS;
+        page_base = 0;
+    } else {
+        struct stat st;
+        if((m->fd = open(source, O_RDWR | O_CREAT, 0644)) == -1) FATAL;
+        if(fstat(m->fd, &st) == -1) FATAL;
+        if(st.st_size < page_base + (off_t) m->map_size)
+            if(ftruncate(m->fd, page_base + m->map_size) == -1) FATAL;
+    }
+
+    m->map_base = mmap(0, m->map_size, PROT_READ | PROT_WRITE, flags, m->fd, page_base);
+    if(m->map_base == (void *) -1) FATAL;
+    m->virt_addr = (char *) m->map_base + (target & page_mask);
+}
+
+static void unmap_target(struct mapping *m) {
+    if(munmap(m->map_base, m->map_size) == -1) FATAL;
+    if(m->fd != -1)
+        close(m->fd);
+}
+
+
+/*
+ * Timestamp source for the benchmark and sampler. Where the CPU offers a user-readable
+ * cycle counter we use it (and calibrate it against CLOCK_MONOTONIC_RAW);
+ * otherwise, or when forced, we fall back to clock_gettime() directly.
+ */
+static int use_clock_gettime = 0;
+static double ticks_per_ns = 1.0;
+
+static inline uint64_t clock_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static inline uint64_t read_ticks(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    if(!use_clock_gettime)
+        return __rdtsc();
+#elif defined(__aarch64__)
+    if(!use_clock_gettime) {
+        uint64_t cnt;
+        asm volatile("isb; mrs %0, cntvct_el0" : "=r" (cnt));
+        return cnt;
+    }
+#endif
+    return clock_ns();
+}
+
+static const char *calibrate_ticks(void) {
+#if defined(__x86_64__) || defined(__i386__) || defined(__aarch64__)
+    if(!use_clock_gettime) {
+        struct timespec pause = {0, 50000000};
+        uint64_t t0 = clock_ns(), c0 = read_ticks();
+        nanosleep(&pause, NULL);
+        uint64_t t1 = clock_ns(), c1 = read_ticks();
+        ticks_per_ns = (double) (c1 - c0) / (t1 - t0);
+#if defined(__aarch64__)
+        return "cntvct_el0";
+#else
+        return "rdtsc";
+#endif
+    }
+#endif
+    use_clock_gettime = 1;
+    ticks_per_ns = 1.0;
+    return "CLOCK_MONOTONIC_RAW";
+}
+
+
+/*
+ * Benchmark mode: sweep access width, stride and read/write mix over a mapped
+ * span, reporting throughput and per-access latency statistics.
+ */
+#define BENCH_MAX_LIST 8
+#define BENCH_HIST_BUCKETS 24
+
+enum write_mode { WRITE_POSTED, WRITE_READBACK };
+
+struct bench_config {
+    int width;
+    size_t stride;
+    size_t span;
+    int read_pct;
+    enum write_mode wmode;
+    unsigned long count;
+};
+
+static int parse_list(const char *arg, long *list) {
+    int n = 0;
+    char *end;
+    while(*arg && n < BENCH_MAX_LIST) {
+        list[n++] = strtol(arg, &end, 0);
+        if(end == arg) {
+            fprintf(stderr, "Bad list element in \"%s\"\n", arg);
+            exit(2);
+        }
+        arg = (*end == ',') ? end + 1 : end;
+    }
+    return n;
+}
+
+/* Access width in bytes for a type letter, or 0 if it isn't one */
+static int bench_width(char type) {
+    switch(tolower(type)) {
+        case 'b': return 1;
+        case 'h': return 2;
+        case 'w': return 4;
+        default: return 0;
+    }
+}
+
+static int cmp_u32(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t *) a, y = *(const uint32_t *) b;
+    return (x > y) - (x < y);
+}
+
+static inline uint32_t do_access(volatile void *addr, int width, int is_read,
+                                 enum write_mode wmode, uint32_t value) {
+    switch(width) {
+        case 1:
+            if(is_read) return *(volatile uint8_t *) addr;
+            *(volatile uint8_t *) addr = value;
+            return wmode == WRITE_READBACK ? *(volatile uint8_t *) addr : 0;
+        case 2:
+            if(is_read) return *(volatile uint16_t *) addr;
+            *(volatile uint16_t *) addr = value;
+            return wmode == WRITE_READBACK ? *(volatile uint16_t *) addr : 0;
+        default:
+            if(is_read) return *(volatile uint32_t *) addr;
+            *(volatile uint32_t *) addr = value;
+            return wmode == WRITE_READBACK ? *(volatile uint32_t *) addr : 0;
+    }
+}
+
+static void run_bench(const struct bench_config *cfg, volatile char *base,
+                      uint32_t *lat, uint8_t *ops, uint64_t overhead, int histogram) {
+    size_t offset;
+    unsigned long i;
+    uint32_t sink = 0, seed = 0x12345678;
+    uint64_t start, elapsed;
+    double secs;
+
+    /* Precompute the read/write sequence so the PRNG stays out of the loop */
+    for(i = 0; i < cfg->count; i++) {
+        seed ^= seed << 13; seed ^= seed >> 17; seed ^= seed << 5;
+        ops[i] = (seed % 100) < (uint32_t) cfg->read_pct;
+    }
+
+    /* Throughput pass: no per-access timestamps */
+    offset = 0;
+    start = read_ticks();
+    for(i = 0; i < cfg->count; i++) {
+        sink += do_access(base + offset, cfg->width, ops[i], cfg->wmode, i);
+        offset += cfg->stride;
+        if(offset + cfg->width > cfg->span)
+            offset = 0;
+    }
+    elapsed = read_ticks() - start;
+    secs = elapsed / ticks_per_ns / 1e9;
+
+    /* Latency pass: timestamp every access */
+    offset = 0;
+    for(i = 0; i < cfg->count; i++) {
+        uint64_t t0 = read_ticks();
+        sink += do_access(base + offset, cfg->width, ops[i], cfg->wmode, i);
+        uint64_t t1 = read_ticks() - t0;
+        t1 = t1 > overhead ? t1 - overhead : 0;
+        lat[i] = t1 / ticks_per_ns;
+        offset += cfg->stride;
+        if(offset + cfg->width > cfg->span)
+            offset = 0;
+    }
+
+    qsort(lat, cfg->count, sizeof(*lat), cmp_u32);
+    printf("%5c %6zu %8zu %4d %-8s %10lu %9.3f %9.3f %7u %7u %7u %7u %8u\n",
+        "?bh?w"[cfg->width], cfg->stride, cfg->span, cfg->read_pct,
+        cfg->read_pct == 100 ? "-" : (cfg->wmode == WRITE_READBACK ? "readback" : "posted"),
+        cfg->count, cfg->count / secs / 1e6, cfg->count * cfg->width / secs / 1e6,
+        lat[cfg->count / 2], lat[cfg->count * 90 / 100], lat[cfg->count * 99 / 100],
+        lat[cfg->count * 999 / 1000], lat[cfg->count - 1]);
+
+    if(histogram) {
+        /* Power-of-two latency buckets, in nanoseconds */
+        unsigned long hist[BENCH_HIST_BUCKETS] = {0}, peak = 0;
+        int b;
+        for(i = 0; i < cfg->count; i++) {
+            for(b = 0; b < BENCH_HIST_BUCKETS - 1 && lat[i] >= (2u << b); b++);
+            hist[b]++;
+        }
+        for(b = 0; b < BENCH_HIST_BUCKETS; b++)
+            if(hist[b] > peak) peak = hist[b];
+        for(b = 0; b < BENCH_HIST_BUCKETS; b++) {
+            if(!hist[b]) continue;
+            printf("      <%8u ns %10lu |", 2u << b, hist[b]);
+            for(int x = 0; x < (int) (hist[b] * 50 / peak); x++) putchar('#');
+            putchar('\n');
+        }
+    }
+    /* Keep the compiler honest about the reads */
+    if(sink == 0xDEADBEEF) putchar(' ');
+}
+
+static int bench_main(int argc, char **argv) {
+    const char *source = NULL, *widths = "bhw", *timer;
+    long strides[BENCH_MAX_LIST] = {0}, mixes[BENCH_MAX_LIST] = {100, 0};
+    int nstrides = 1, nmixes = 2, histogram = 0, opt;
+    int wmodes[2] = {WRITE_POSTED, WRITE_READBACK}, nwmodes = 2;
+    struct bench_config cfg = {0};
+    struct mapping m;
+    off_t target = 0;
+    uint32_t *lat;
+    uint8_t *ops;
+    uint64_t overhead = UINT64_MAX;
+
+    cfg.span = sysconf(_SC_PAGESIZE);
+    cfg.count = 100000;
+
+    while((opt = getopt(argc, argv, "f:aw:s:S:r:pbn:Hc")) != -1) {
+        switch(opt) {
+            case 'f': source = optarg; break;
+            case 'a': source = "anon"; break;
+            case 'w': widths = optarg; break;
+            case 's': nstrides = parse_list(optarg, strides); break;
+            case 'S': cfg.span = strtoul(optarg, 0, 0); break;
+            case 'r': nmixes = parse_list(optarg, mixes); break;
+            case 'p': wmodes[0] = WRITE_POSTED; nwmodes = 1; break;
+            case 'b': wmodes[0] = WRITE_READBACK; nwmodes = 1; break;
+            case 'n': cfg.count = strtoul(optarg, 0, 0); break;
+            case 'H': histogram = 1; break;
+            case 'c': use_clock_gettime = 1; break;
+            default:
+                fprintf(stderr, "\nUsage:\t%s bench [ options ] [ address ]\n"
+                    "\t-f file  : benchmark a file-backed mapping instead of /dev/mem\n"
+                    "\t-a       : benchmark an anonymous mapping instead of /dev/mem\n"
+                    "\t-w types : access widths to sweep, e.g. \"bhw\" (default)\n"
+                    "\t-s list  : strides in bytes, e.g. \"4,64\" (default: access width)\n"
+                    "\t-S span  : bytes to cycle through (default: one page)\n"
+                    "\t-r list  : read percentages to sweep (default: \"100,0\")\n"
+                    "\t-p / -b  : only posted / only read-back writes (default: both)\n"
+                    "\t-n count : accesses per configuration (default: 100000)\n"
+                    "\t-H       : print a latency histogram for each configuration\n"
+                    "\t-c       : time with clock_gettime() instead of a cycle counter\n\n",
+                    argv[0]);
+                exit(1);
+        }
+    }
+    if(optind < argc)
+        target = strtoul(argv[optind], 0, 0);
+    else if(source == NULL) {
+        fprintf(stderr, "An address is required when benchmarking /dev/mem\n");
+        exit(1);
+    }
+    if(cfg.count == 0 || cfg.span == 0) {
+        fprintf(stderr, "Access count and span must be nonzero\n");
+        exit(1);
+    }
+    for(const char *w = widths; *w; w++) {
+        if(bench_width(*w) == 0) {
+            fprintf(stderr, "Illegal data type '%c'.\n", *w);
+            exit(2);
+        }
+        if(cfg.span < (size_t) bench_width(*w)) {
+            fprintf(stderr, "Span must be at least the access width (%d bytes)\n", bench_width(*w));
+            exit(1);
+        }
+    }
+    for(int r = 0; r < nmixes; r++) {
+        if(mixes[r] < 0 || mixes[r] > 100) {
+            fprintf(stderr, "Read percentages must be 0 to 100\n");
+            exit(1);
+        }
+    }
+
+    map_target(&m, source, target, cfg.span);
+    if((lat = malloc(cfg.count * sizeof(*lat))) == NULL) FATAL;
+    if((ops = malloc(cfg.count)) == NULL) FATAL;
+
+    /* Calibrate the timer and the cost of taking back-to-back timestamps */
+    timer = calibrate_ticks();
+    for(int i = 0; i < 1000; i++) {
+        uint64_t t0 = read_ticks();
+        uint64_t t1 = read_ticks() - t0;
+        if(t1 < overhead) overhead = t1;
+    }
+    printf("Benchmarking 0x%lX (%s), %zu byte span; timer %s, %.3f ticks/ns, overhead %lu ticks\n",
+        (unsigned long) target, source ? source : "/dev/mem", cfg.span,
+        timer, ticks_per_ns, (unsigned long) overhead);
+    printf("%5s %6s %8s %4s %-8s %10s %9s %9s %7s %7s %7s %7s %8s\n",
+        "width", "stride", "span", "rd%", "writes", "accesses", "Macc/s", "MB/s",
+        "p50ns", "p90ns", "p99ns", "p999ns", "maxns");
+
+    for(const char *w = widths; *w; w++) {
+        cfg.width = bench_width(*w);
+        for(int s = 0; s < nstrides; s++) {
+            cfg.stride = strides[s] ? (size_t) strides[s] : (size_t) cfg.width;
+            for(int r = 0; r < nmixes; r++) {
+                cfg.read_pct = mixes[r];
+                for(int wm = 0; wm < nwmodes; wm++) {
+                    cfg.wmode = wmodes[wm];
+                    run_bench(&cfg, m.virt_addr, lat, ops, overhead, histogram);
+                    /* Write mode is irrelevant for a pure read workload */
+                    if(cfg.read_pct >= 100) break;
+                }
+            }
+        }
+        fflush(stdout);
+    }
+
+    free(ops);
+    free(lat);
+    unmap_target(&m);
+    return 0;
+}
+
+
+/*
+ * Sampling mode: poll one or more addresses in a tight loop, record only the
+ * changes into a preallocated ring, and let a second thread drain the ring
+ * into a VCD file. The polling thread never blocks on I/O; if the writer falls
+ * behind, changes are dropped and counted instead, and each channel's latest
+ * value is recorded (late) once there is room again, so the VCD never ends
+ * up holding a stale value.
+ */
+#define SAMPLE_MAX_CHANNELS 16
+
+struct sample_event {
+    uint64_t ticks;
+    uint32_t value;
+    uint32_t channel;
+};
+
+struct sample_ring {
+    struct sample_event *events;
+    size_t mask;
+    /* head is only written by the sampler, tail only by the writer */
+    size_t head;
+    size_t tail;
+    int done;
+};
+
+struct sample_writer {
+    struct sample_ring *ring;
+    FILE *vcd;
+    uint64_t start;
+    int widths[SAMPLE_MAX_CHANNELS];
+};
+
+static volatile sig_atomic_t sample_stop = 0;
+static void sample_sigint(int sig) {
+    (void) sig;
+    sample_stop = 1;
+}
+
+static void vcd_value(FILE *vcd, uint32_t value, int width, int channel) {
+    char bits[33];
+    int nbits = width * 8;
+    for(int b = 0; b < nbits; b++)
+        bits[b] = (value >> (nbits - 1 - b)) & 1 ? '1' : '0';
+    bits[nbits] = '\0';
+    fprintf(vcd, "b%s %c\n", bits, '!' + channel);
+}
+
+static void *sample_writer_thread(void *arg) {
+    struct sample_writer *w = arg;
+    struct sample_ring *ring = w->ring;
+    struct timespec idle = {0, 1000000};
+    uint64_t last_ns = 0;
+
+    for(;;) {
+        size_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+        size_t tail = ring->tail;
+        if(tail == head) {
+            if(__atomic_load_n(&ring->done, __ATOMIC_ACQUIRE)
+                    && tail == __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE))
+                break;
+            nanosleep(&idle, NULL);
+            continue;
+        }
+        for(; tail != head; tail++) {
+            struct sample_event *e = &ring->events[tail & ring->mask];
+            uint64_t ns = (e->ticks - w->start) / ticks_per_ns;
+            if(ns != last_ns) {
+                fprintf(w->vcd, "#%lu\n", (unsigned long) ns);
+                last_ns = ns;
+            }
+            vcd_value(w->vcd, e->value, w->widths[e->channel], e->channel);
+        }
+        __atomic_store_n(&ring->tail, tail, __ATOMIC_RELEASE);
+    }
+    return NULL;
+}
+
+static int sample_main(int argc, char **argv) {
+    const char *source = NULL, *outfile = "mydevmem.vcd", *timer;
+    int cpu = -1, realtime = 0, nchan = 0, opt;
+    double duration = 0;
+    size_t ring_size = 1 << 20;
+    struct mapping maps[SAMPLE_MAX_CHANNELS];
+    volatile void *addrs[SAMPLE_MAX_CHANNELS];
+    uint32_t last[SAMPLE_MAX_CHANNELS];
+    off_t targets[SAMPLE_MAX_CHANNELS];
+    struct sample_ring ring = {0};
+    struct sample_writer writer = {0};
+    unsigned long polls = 0, changes = 0, dropped = 0;
+    uint64_t stop_ticks = 0, now;
+    pthread_t thread;
+    FILE *vcd;
+
+    while((opt = getopt(argc, argv, "f:ao:C:Rt:N:")) != -1) {
+        switch(opt) {
+            case 'f': source = optarg; break;
+            case 'a': source = "anon"; break;
+            case 'o': outfile = optarg; break;
+            case 'C': cpu = strtol(optarg, 0, 0); break;
+            case 'R': realtime = 1; break;
+            case 't': duration = strtod(optarg, 0); break;
+            case 'N': ring_size = strtoul(optarg, 0, 0); break;
+            default:
+                fprintf(stderr, "\nUsage:\t%s sample [ options ] { address[:type] } [ ... ]\n"
+                    "\ttype     : access type : [b]yte, [h]alfword, [w]ord (default)\n"
+                    "\t-o file  : VCD output file (default: mydevmem.vcd)\n"
+                    "\t-C cpu   : pin the sampling loop to the given CPU\n"
+                    "\t-R       : run the sampling loop under SCHED_FIFO\n"
+                    "\t-t secs  : stop after the given time (default: until SIGINT)\n"
+                    "\t-N count : change buffer entries, a power of two (default: 1048576)\n"
+                    "\t-f file  : sample a file-backed mapping instead of /dev/mem\n"
+                    "\t-a       : sample an anonymous mapping instead of /dev/mem\n\n",
+                    argv[0]);
+                exit(1);
+        }
+    }
+    if(optind >= argc) {
+        fprintf(stderr, "At least one address is required\n");
+        exit(1);
+    }
+    if(ring_size == 0 || (ring_size & (ring_size - 1))) {
+        fprintf(stderr, "Buffer size must be a power of two\n");
+        exit(1);
+    }
+    if(argc - optind > SAMPLE_MAX_CHANNELS) {
+        fprintf(stderr, "At most %d addresses can be sampled\n", SAMPLE_MAX_CHANNELS);
+        exit(1);
+    }
+
+    for(; optind < argc && nchan < SAMPLE_MAX_CHANNELS; optind++, nchan++) {
+        char *type;
+        targets[nchan] = strtoul(argv[optind], &type, 0);
+        switch(*type == ':' ? tolower(type[1]) : 'w') {
+            case 'b': writer.widths[nchan] = 1; break;
+            case 'h': writer.widths[nchan] = 2; break;
+            case 'w': writer.widths[nchan] = 4; break;
+            default:
+                fprintf(stderr, "Illegal data type '%c'.\n", type[1]);
+                exit(2);
+        }
+        map_target(&maps[nchan], source, targets[nchan], writer.widths[nchan]);
+        addrs[nchan] = maps[nchan].virt_addr;
+    }
+
+    /* Preallocate and fault in the change buffer before sampling starts */
+    if((ring.events = malloc(ring_size * sizeof(*ring.events))) == NULL) FATAL;
+    memset(ring.events, 0, ring_size * sizeof(*ring.events));
+    ring.mask = ring_size - 1;
+
+    if((vcd = fopen(outfile, "w")) == NULL) FATAL;
+    timer = calibrate_ticks();
+    fprintf(vcd, "$version mydevmem sample $end\n$timescale 1ns $end\n$scope module mydevmem $end\n");
+    for(int c = 0; c < nchan; c++)
+        fprintf(vcd, "$var wire %d %c addr_%lX $end\n",
+            writer.widths[c] * 8, '!' + c, (unsigned long) targets[c]);
+    fprintf(vcd, "$upscope $end\n$enddefinitions $end\n#0\n$dumpvars\n");
+    for(int c = 0; c < nchan; c++) {
+        last[c] = do_access(addrs[c], writer.widths[c], 1, WRITE_POSTED, 0);
+        vcd_value(vcd, last[c], writer.widths[c], c);
+    }
+    fprintf(vcd, "$end\n");
+
+    /* Start the writer before pinning, so it doesn't inherit our CPU */
+    writer.ring = &ring;
+    writer.vcd = vcd;
+    writer.start = read_ticks();
+    if(pthread_create(&thread, NULL, sample_writer_thread, &writer)) FATAL;
+    if(cpu >= 0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        if(sched_setaffinity(0, sizeof(set), &set) == -1) FATAL;
+    }
+    if(realtime) {
+        struct sched_param sp = {.sched_priority = sched_get_priority_max(SCHED_FIFO)};
+        if(sched_setscheduler(0, SCHED_FIFO, &sp) == -1) FATAL;
+    }
+    signal(SIGINT, sample_sigint);
+    if(duration > 0)
+        stop_ticks = writer.start + (uint64_t) (duration * 1e9 * ticks_per_ns);
+
+    /* The sampling loop proper */
+    while(!sample_stop) {
+        now = read_ticks();
+        for(int c = 0; c < nchan; c++) {
+            uint32_t value = do_access(addrs[c], writer.widths[c], 1, WRITE_POSTED, 0);
+            if(value == last[c])
+                continue;
+            size_t head = ring.head;
+            if(head - __atomic_load_n(&ring.tail, __ATOMIC_ACQUIRE) > ring.mask) {
+                /* last[c] stays as recorded, so the change is retried */
+                dropped++;
+                continue;
+            }
+            ring.events[head & ring.mask] = (struct sample_event) {now, value, c};
+            __atomic_store_n(&ring.head, head + 1, __ATOMIC_RELEASE);
+            last[c] = value;
+            changes++;
+        }
+        polls++;
+        if(stop_ticks && now >= stop_ticks)
+            break;
+    }
+    now = read_ticks();
+
+    __atomic_store_n(&ring.done, 1, __ATOMIC_RELEASE);
+    pthread_join(thread, NULL);
+    fclose(vcd);
+
+    double secs = (now - writer.start) / ticks_per_ns / 1e9;
+    fprintf(stderr, "Sampled %d address(es) %lu times in %.3f s (%.3f Msamples/s, timer %s)\n"
+        "Recorded %lu changes to %s; dropped %lu\n",
+        nchan, polls, secs, polls / secs / 1e6, timer, changes, outfile, dropped);
+
+    for(int c = 0; c < nchan; c++)
+        unmap_target(&maps[c]);
+    free(ring.events);
+    return dropped ? 3 : 0;
+}
+
+
 int main(int argc, char **argv) {
     int fd;
     void *map_base, *virt_addr;
@@ -54,13 +627,21 @@ int main(int argc, char **argv) {
 
     if(argc < 2) {
         fprintf(stderr, "\nUsage:\t%s { address } [ type [ data ] ]\n"
+            "\t%s bench [ options ] [ address ]\n"
+            "\t%s sample [ options ] { address[:type] } [ ... ]\n"
             "\taddress : memory address to act upon\n"
             "\ttype    : access operation type : [b]yte, [h]alfword, [w]ord\n"
             "\tdata    : data to be written\n"
+            "\tbench   : benchmark accesses (run \"%s bench -h\" for options)\n"
+            "\tsample  : record register changes to a VCD file (run \"%s sample -h\")\n"
             "System reports page size of %ld bytes\n\n",
-            argv[0], map_size);
+            argv[0], argv[0], argv[0], argv[0], argv[0], map_size);
         exit(1);
     }
+    if(strcmp(argv[1], "bench") == 0)
+        return bench_main(argc - 1, argv + 1);
+    if(strcmp(argv[1], "sample") == 0)
+        return sample_main(argc - 1, argv + 1);
     target = strtoul(argv[1], 0, 0);
 
     if(argc > 2)
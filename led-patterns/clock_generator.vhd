@@ -19,50 +19,129 @@ entity ClockGenerator is
     );
     port (
         -- System clock
-        clk        : in    std_logic;
+        clk         : in    std_logic;
         -- NOTE: Active high reset
-        reset      : in    std_logic;
+        reset       : in    std_logic;
         -- Base transition period, in seconds (UQ4.4)
-        Base_rate  : in    unsigned(7 downto 0);
+        Base_rate   : in    unsigned(7 downto 0);
+        -- Base transition period, in system clock cycles, used instead of
+        -- Base_rate unless zero
+        Base_period : in    unsigned(31 downto 0);
+        -- Shared fractional tick, pulsed 16 times per Base_rate period
+        fine_tick   : out   std_logic;
         -- Generated clock outputs
-        gen_clocks : out   std_logic_vector(CLK_SCALES'range)
+        gen_clocks  : out   std_logic_vector(CLK_SCALES'range)
     );
 end entity;
 
 
+-- All generated clocks are derived from one shared "fine tick", which occurs
+-- every Base_rate/16 seconds (i.e. every Base_rate * SYS_CLKs_sec / 256 system
+-- clock cycles). A fractional accumulator produces that tick without drift,
+-- and each output then just counts CLK_SCALES(N) fine ticks. The only wide
+-- product is computed by a sequential multiplier when Base_rate changes.
+-- Base_period gives that product directly (as 16 * Base_period), so it can
+-- set periods down to a few cycles, in single-cycle steps.
 architecture ClockGenerator_Arch of ClockGenerator is
+
+    -- Product of Base_rate and SYS_CLKs_sec, i.e. system clock cycles per 256
+    -- fine ticks; wide enough for either source
+    constant PRODUCT_BITS : positive :=
+        maximum(SYS_CLKs_sec'length + Base_rate'length, Base_period'length + 4);
+    signal product : unsigned(PRODUCT_BITS - 1 downto 0);
+    signal tick    : std_logic;
+
 begin
 
+    -- Shift-and-add multiplier, processing one bit of Base_rate per cycle
+    -- NOTE: The previous product stays in use while a new one is computed
+    rate_multiplier : process (clk, reset) is
+        variable operand   : unsigned(Base_rate'range);
+        variable partial   : unsigned(product'range);
+        variable bit_index : natural range 0 to Base_rate'length;
+        variable busy      : boolean;
+        -- Set while Base_period is in use, so that switching back to
+        -- Base_rate recomputes its product even if Base_rate is unchanged
+        variable stale     : boolean;
+    begin
+        if reset then
+            product   <= (others => '0');
+            operand   := (others => '0');
+            partial   := (others => '0');
+            bit_index := 0;
+            busy      := false;
+            stale     := false;
+        elsif rising_edge(clk) then
+            if Base_period /= 0 then
+                product <= shift_left(resize(Base_period, product'length), 4);
+                busy    := false;
+                stale   := true;
+            elsif busy then
+                if bit_index = Base_rate'length then
+                    product <= partial;
+                    busy    := false;
+                else
+                    if operand(bit_index) then
+                        partial := partial + shift_left(resize(SYS_CLKs_sec, partial'length), bit_index);
+                    end if;
+                    bit_index := bit_index + 1;
+                end if;
+            elsif stale or operand /= Base_rate then
+                stale     := false;
+                operand   := Base_rate;
+                partial   := (others => '0');
+                bit_index := 0;
+                busy      := true;
+            end if;
+        end if;
+    end process;
+
+    -- Shared fractional accumulator, adding 256 per cycle and emitting a fine
+    -- tick each time it passes the product
+    fine_tick_fsm : process (clk, reset) is
+        variable acc, next_acc : unsigned(product'length downto 0);
+    begin
+        if reset then
+            tick <= '0';
+            acc  := (others => '0');
+        elsif rising_edge(clk) then
+            next_acc := acc + 256;
+            tick     <= '0';
+            if product = 0 then
+                -- A zero period stops all generated clocks
+                acc := (others => '0');
+            elsif next_acc >= product then
+                tick <= '1';
+                acc  := next_acc - product;
+                -- Saturate at one tick per cycle if the rate is too fast
+                if acc >= product then
+                    acc := (others => '0');
+                end if;
+            else
+                acc := next_acc;
+            end if;
+        end if;
+    end process;
+    fine_tick <= tick;
+
     -- Clock generator state-machine array
     clock_fsm_array : for N in CLK_SCALES'range generate
         clock_fsm : process (clk, reset) is
-            variable limit : unsigned(
-                    SYS_CLKs_sec'length
-                        + Base_rate'length
-                        + CLK_SCALES(N)'length
-                        - 1
-                    downto 0
-                );
-            variable ticks : unsigned(
-                    SYS_CLKs_sec'length
-                        + Base_rate'length - 4
-                        + CLK_SCALES(N)'length - 4
-                        - 1
-                    downto 0
-                );
+            variable ticks : unsigned(CLK_SCALES(N)'range);
         begin
 
             if reset then
                 gen_clocks(N) <= '0';
                 ticks         := to_unsigned(0, ticks'length);
             elsif rising_edge(clk) then
-                limit := unsigned(CLK_SCALES(N)) * Base_rate * SYS_CLKs_sec;
-                if ticks < limit(limit'high downto limit'low + 8) - 1 then
-                    gen_clocks(N) <= '0';
-                    ticks         := ticks + 1;
-                else
-                    gen_clocks(N) <= '1';
-                    ticks         := to_unsigned(0, ticks'length);
+                gen_clocks(N) <= '0';
+                if tick then
+                    if ticks >= unsigned(CLK_SCALES(N)) - 1 then
+                        gen_clocks(N) <= '1';
+                        ticks         := to_unsigned(0, ticks'length);
+                    else
+                        ticks := ticks + 1;
+                    end if;
                 end if;
             end if;
 
@@ -0,0 +1,267 @@
+// HPS_LED_Patterns co-simulation server
+// Linked into the GHDL simulation of hps_led_patterns_cosim.vhd, whose bus
+// host process calls these functions through VHPIDIRECT. Software connects to
+// a Unix socket (see cosim_client.h), and each of its register reads and
+// writes is run as an Avalon transfer on the simulated RTL.
+//
+// Configured through the environment, since GHDL owns the command line:
+//   COSIM_SOCKET  socket path (default /tmp/hps_led_patterns.sock)
+//   COSIM_SCALE   simulated seconds per wall-clock second; unset or 0 runs
+//                 as fast as possible
+//   COSIM_REPORT  seconds between simulation rate reports (default 5; 0 for
+//                 none but the last)
+//   COSIM_TRACE   if set, print every change of the LED and irq outputs; only
+//                 the lowest 31 LEDs are traced, since cosim_poll() gets them
+//                 as a VHDL integer
+
+#define _GNU_SOURCE
+#include <stdbool.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "cosim_client.h"
+
+#define NSEC_PER_SEC ((int64_t)1000000000)
+#define MAX_CLIENTS 8
+// Cycles between checks for requests (and of the wall clock), so that the
+// simulation isn't dominated by system calls
+#define POLL_CYCLES 64
+
+// Request codes, as in the Cosim_Host package
+#define COSIM_IDLE 0
+#define COSIM_READ 1
+#define COSIM_WRITE 2
+#define COSIM_QUIT 3
+
+static struct {
+    const char *path;
+    int listen_fd;
+    int clients[MAX_CLIENTS];
+    int num_clients;
+    int next_client;        // Where the next round-robin scan starts
+    int current;            // Client awaiting a reply, or -1
+    struct cosim_request request;
+    // Simulated time
+    int64_t clock_freq;
+    uint64_t cycles;
+    uint64_t next_check;
+    uint64_t requests;
+    // Pacing and reporting
+    double scale;
+    int64_t start_ns;
+    int64_t report_ns;
+    int64_t last_report_ns;
+    uint64_t last_report_cycles;
+    uint64_t last_report_requests;
+    // Tracing, with one hex digit per four traced LEDs
+    bool trace;
+    int led_digits;
+    int last_led, last_irq;
+} cosim = {.listen_fd = -1, .current = -1, .last_led = -1, .last_irq = -1};
+
+static volatile sig_atomic_t quit = 0;
+static void quit_handler(int _) {
+    (void)_;
+    quit = 1;
+}
+
+
+static int64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+}
+
+// Print the simulation rate since the previous report (or, at the end, since
+// the start)
+static void report(int64_t now, bool final) {
+    int64_t since = final ? cosim.start_ns : cosim.last_report_ns;
+    uint64_t cycles = cosim.cycles - (final ? 0 : cosim.last_report_cycles);
+    uint64_t requests = cosim.requests - (final ? 0 : cosim.last_report_requests);
+    double wall = (double)(now - since) / NSEC_PER_SEC;
+    double rate = wall > 0 ? cycles / wall : 0;
+    fprintf(stderr, "cosim: %s%" PRIu64 " cycles (%.6f s simulated) in %.3f s: "
+            "%.0f cycles/s, %.5fx real time, %" PRIu64 " requests\n",
+            final ? "total " : "", cycles, (double)cycles / cosim.clock_freq, wall,
+            rate, rate / cosim.clock_freq, requests);
+    cosim.last_report_ns = now;
+    cosim.last_report_cycles = cosim.cycles;
+    cosim.last_report_requests = cosim.requests;
+}
+
+static void drop_client(int i) {
+    close(cosim.clients[i]);
+    cosim.clients[i] = cosim.clients[--cosim.num_clients];
+}
+
+// Wait up to timeout_ns for a request, accepting new clients meanwhile
+// Returns the request code
+static int serve(int64_t timeout_ns) {
+    struct pollfd fds[1 + MAX_CLIENTS];
+    struct timespec timeout = {timeout_ns / NSEC_PER_SEC, timeout_ns % NSEC_PER_SEC};
+
+    fds[0] = (struct pollfd) {.fd = cosim.listen_fd, .events = POLLIN};
+    for (int i = 0; i < cosim.num_clients; i++) {
+        fds[1 + i] = (struct pollfd) {.fd = cosim.clients[i], .events = POLLIN};
+    }
+    int ready = ppoll(fds, 1 + cosim.num_clients, &timeout, NULL);
+    if (ready <= 0) {
+        return COSIM_IDLE;
+    }
+
+    // Take one request, starting after the last client served
+    int num_clients = cosim.num_clients;
+    for (int n = 0; n < num_clients; n++) {
+        int i = (cosim.next_client + n) % num_clients;
+        if (!(fds[1 + i].revents & (POLLIN | POLLHUP | POLLERR))) {
+            continue;
+        }
+        ssize_t got = recv(cosim.clients[i], &cosim.request, sizeof(cosim.request), MSG_WAITALL);
+        bool valid = got == sizeof(cosim.request)
+            && (cosim.request.op == COSIM_OP_READ || cosim.request.op == COSIM_OP_WRITE)
+            && cosim.request.offset < COSIM_SPAN && cosim.request.offset % 4 == 0;
+        if (!valid) {
+            // Disconnected, or not speaking the protocol
+            if (got > 0) {
+                fprintf(stderr, "cosim: dropping client after a malformed request\n");
+            }
+            drop_client(i);
+            return COSIM_IDLE;
+        }
+        cosim.current = cosim.clients[i];
+        cosim.next_client = i + 1;
+        cosim.requests++;
+        return cosim.request.op == COSIM_OP_READ ? COSIM_READ : COSIM_WRITE;
+    }
+
+    if (fds[0].revents & POLLIN) {
+        int fd = accept(cosim.listen_fd, NULL, NULL);
+        if (fd != -1 && cosim.num_clients == MAX_CLIENTS) {
+            fprintf(stderr, "cosim: refusing client; already serving %d\n", MAX_CLIENTS);
+            close(fd);
+        } else if (fd != -1) {
+            cosim.clients[cosim.num_clients++] = fd;
+        }
+    }
+    return COSIM_IDLE;
+}
+
+static void stop(void) {
+    if (cosim.listen_fd == -1) {
+        return;
+    }
+    report(now_ns(), true);
+    for (int i = 0; i < cosim.num_clients; i++) {
+        close(cosim.clients[i]);
+    }
+    close(cosim.listen_fd);
+    unlink(cosim.path);
+    cosim.listen_fd = -1;
+}
+
+
+void cosim_start(int clock_freq, int led_width) {
+    const char *scale = getenv("COSIM_SCALE");
+    const char *interval = getenv("COSIM_REPORT");
+    cosim.path = getenv("COSIM_SOCKET") ? getenv("COSIM_SOCKET") : COSIM_DEFAULT_SOCKET;
+    cosim.scale = scale ? strtod(scale, NULL) : 0;
+    cosim.report_ns = (interval ? strtod(interval, NULL) : 5) * NSEC_PER_SEC;
+    cosim.trace = getenv("COSIM_TRACE") != NULL;
+    cosim.clock_freq = clock_freq;
+    cosim.led_digits = ((led_width < 31 ? led_width : 31) + 3) / 4;
+
+    struct sockaddr_un addr = {.sun_family = AF_UNIX};
+    if (strlen(cosim.path) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "cosim: socket path \"%s\" is too long\n", cosim.path);
+        exit(1);
+    }
+    strcpy(addr.sun_path, cosim.path);
+    // Replace any socket left behind by an earlier run
+    unlink(cosim.path);
+    cosim.listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (cosim.listen_fd == -1
+            || bind(cosim.listen_fd, (struct sockaddr *) &addr, sizeof(addr)) == -1
+            || listen(cosim.listen_fd, MAX_CLIENTS) == -1) {
+        fprintf(stderr, "cosim: failed to listen on \"%s\": %s\n", cosim.path, strerror(errno));
+        exit(1);
+    }
+
+    signal(SIGINT, quit_handler);
+    signal(SIGTERM, quit_handler);
+    atexit(stop);
+    if (cosim.scale > 0) {
+        fprintf(stderr, "cosim: serving %s at %g simulated seconds per second\n",
+                cosim.path, cosim.scale);
+    } else {
+        fprintf(stderr, "cosim: serving %s, free-running\n", cosim.path);
+    }
+    cosim.start_ns = cosim.last_report_ns = now_ns();
+}
+
+int cosim_poll(int cycles, int led, int irq) {
+    cosim.cycles += cycles;
+    if (cosim.trace && (led != cosim.last_led || irq != cosim.last_irq)) {
+        printf("%.9f LED 0x%0*X irq %d\n", (double)cosim.cycles / cosim.clock_freq,
+               cosim.led_digits, (unsigned int)led, irq);
+        cosim.last_led = led;
+        cosim.last_irq = irq;
+    }
+    if (quit) {
+        return COSIM_QUIT;
+    }
+    if (cosim.cycles < cosim.next_check) {
+        return COSIM_IDLE;
+    }
+    cosim.next_check = cosim.cycles + POLL_CYCLES;
+
+    int64_t now = now_ns();
+    if (cosim.report_ns > 0 && now - cosim.last_report_ns >= cosim.report_ns) {
+        report(now, false);
+    }
+    // When time-scaled, wait for requests until wall-clock time catches up
+    // with the simulation (or not at all, if it is behind)
+    int64_t timeout = 0;
+    if (cosim.scale > 0) {
+        int64_t due = cosim.start_ns
+            + (int64_t)(cosim.cycles * (double)NSEC_PER_SEC / (cosim.clock_freq * cosim.scale));
+        if (due > now) {
+            timeout = due - now;
+        }
+    }
+    return serve(timeout);
+}
+
+int cosim_address(void) {
+    return cosim.request.offset / 4;
+}
+
+int cosim_writedata(void) {
+    return (int32_t)cosim.request.data;
+}
+
+void cosim_reply(int data) {
+    uint32_t reply = data;
+    if (cosim.current == -1) {
+        return;
+    }
+    if (send(cosim.current, &reply, sizeof(reply), MSG_NOSIGNAL) != sizeof(reply)) {
+        // The client went away mid-request; forget it
+        for (int i = 0; i < cosim.num_clients; i++) {
+            if (cosim.clients[i] == cosim.current) {
+                drop_client(i);
+                break;
+            }
+        }
+    }
+    cosim.current = -1;
+}
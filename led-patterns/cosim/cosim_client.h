@@ -0,0 +1,71 @@
+// Client side of the HPS_LED_Patterns co-simulation socket
+// Each request is three host-order 32-bit words (operation, byte offset from
+// the component base, write data), answered by one word (read data, or 0 for
+// a write) once the simulated transfer completes.
+
+#ifndef COSIM_CLIENT_H
+#define COSIM_CLIENT_H
+
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#define COSIM_DEFAULT_SOCKET "/tmp/hps_led_patterns.sock"
+// Component address span, in bytes (10-bit word address)
+#define COSIM_SPAN 0x1000
+
+#define COSIM_OP_READ 1
+#define COSIM_OP_WRITE 2
+
+struct cosim_request {
+    uint32_t op;
+    uint32_t offset;
+    uint32_t data;
+};
+
+// Connect to a co-simulation server
+// Returns a socket, or -1 (with errno set) on failure
+static inline int cosim_connect(const char *path) {
+    struct sockaddr_un addr = {.sun_family = AF_UNIX};
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        return -1;
+    }
+    strcpy(addr.sun_path, path);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd == -1) {
+        return -1;
+    }
+    if (connect(fd, (struct sockaddr *) &addr, sizeof(addr)) == -1) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// Run one register transfer, waiting for the simulated bus to complete it
+// Returns 0, or -1 if the server went away
+static inline int cosim_transfer(int fd, uint32_t op, uint32_t offset, uint32_t data,
+        uint32_t *result) {
+    struct cosim_request request = {op, offset, data};
+    uint32_t reply;
+    if (send(fd, &request, sizeof(request), MSG_NOSIGNAL) != sizeof(request)
+            || recv(fd, &reply, sizeof(reply), MSG_WAITALL) != sizeof(reply)) {
+        return -1;
+    }
+    if (result) {
+        *result = reply;
+    }
+    return 0;
+}
+
+static inline int cosim_write(int fd, uint32_t offset, uint32_t data) {
+    return cosim_transfer(fd, COSIM_OP_WRITE, offset, data, NULL);
+}
+
+static inline int cosim_read(int fd, uint32_t offset, uint32_t *data) {
+    return cosim_transfer(fd, COSIM_OP_READ, offset, 0, data);
+}
+
+#endif
@@ -0,0 +1,185 @@
+-- Lucas Ritzdorf
+-- 10/19/2026
+-- EELE 467, LED Patterns
+
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+
+-- Bus request server, implemented in C (cosim.c) and called through GHDL's
+-- VHPIDIRECT interface
+package Cosim_Host is
+
+    -- Start serving requests, for a DUT clocked at the given frequency and
+    -- driving the given number of LEDs
+    procedure cosim_start (clock_freq : integer; led_width : integer);
+    attribute foreign of cosim_start : procedure is "VHPIDIRECT cosim_start";
+
+    -- Request codes returned by cosim_poll
+    constant COSIM_IDLE  : integer := 0;
+    constant COSIM_READ  : integer := 1;
+    constant COSIM_WRITE : integer := 2;
+    constant COSIM_QUIT  : integer := 3;
+
+    -- Advance the host's view of time by some clock cycles, report the LED
+    -- (the lowest 31 of them) and interrupt outputs, and fetch the next bus request (if any); this
+    -- also paces the simulation when it runs time-scaled
+    impure function cosim_poll (cycles : integer; led : integer; irq : integer) return integer;
+    attribute foreign of cosim_poll : function is "VHPIDIRECT cosim_poll";
+
+    -- Word address and write data of the current request
+    impure function cosim_address return integer;
+    attribute foreign of cosim_address : function is "VHPIDIRECT cosim_address";
+    impure function cosim_writedata return integer;
+    attribute foreign of cosim_writedata : function is "VHPIDIRECT cosim_writedata";
+
+    -- Complete the current request, returning read data to its client
+    procedure cosim_reply (data : integer);
+    attribute foreign of cosim_reply : procedure is "VHPIDIRECT cosim_reply";
+
+end package;
+
+
+package body Cosim_Host is
+
+    -- NOTE: These bodies are never run; GHDL links the C implementations
+
+    procedure cosim_start (clock_freq : integer; led_width : integer) is
+    begin
+        report "VHPIDIRECT cosim_start" severity failure;
+    end procedure;
+
+    impure function cosim_poll (cycles : integer; led : integer; irq : integer) return integer is
+    begin
+        report "VHPIDIRECT cosim_poll" severity failure;
+    end function;
+
+    impure function cosim_address return integer is
+    begin
+        report "VHPIDIRECT cosim_address" severity failure;
+    end function;
+
+    impure function cosim_writedata return integer is
+    begin
+        report "VHPIDIRECT cosim_writedata" severity failure;
+    end function;
+
+    procedure cosim_reply (data : integer) is
+    begin
+        report "VHPIDIRECT cosim_reply" severity failure;
+    end procedure;
+
+end package body;
+
+
+use std.env.all;
+use work.Avalon_BFM.all;
+use work.Cosim_Host.all;
+use work.common.all;
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+
+-- HPS_LED_Patterns co-simulation top level: the Avalon port is driven by
+-- requests from software, via the C server
+entity HPS_LED_Patterns_Cosim is
+    generic (
+        -- Number of system clock cycles per second; lower it (e.g. with
+        -- -gSYS_CLK_FREQ=100000) to let a time-scaled run keep up
+        SYS_CLK_FREQ : natural := 50000000;
+        -- Number of LEDs; only the lowest 31 are reported to the C server,
+        -- since they are passed as a VHDL integer
+        LED_WIDTH    : positive range 3 to LED_WIDTH_MAX := 8
+    );
+end entity;
+
+architecture HPS_LED_Patterns_Cosim_Arch of HPS_LED_Patterns_Cosim is
+    constant CLK_PER : time := 1 sec / SYS_CLK_FREQ;
+
+    signal clk, reset : std_logic;
+    signal m2s        : avalon_m2s_t;
+    signal s2m        : avalon_s2m_t;
+    signal LED        : std_logic_vector(LED_WIDTH - 1 downto 0);
+    signal irq        : std_logic;
+begin
+
+    -- HPS_LED_Patterns instance
+    dut : entity work.HPS_LED_Patterns
+        generic map (
+            SYS_CLK_FREQ => SYS_CLK_FREQ,
+            LED_WIDTH    => LED_WIDTH
+        )
+        port map (
+            clk                  => clk,
+            reset                => reset,
+            avs_s1_read          => m2s.read,
+            avs_s1_write         => m2s.write,
+            avs_s1_address       => m2s.address,
+            avs_s1_burstcount    => m2s.burstcount,
+            avs_s1_byteenable    => m2s.byteenable,
+            avs_s1_waitrequest   => s2m.waitrequest,
+            avs_s1_readdata      => s2m.readdata,
+            avs_s1_readdatavalid => s2m.readdatavalid,
+            avs_s1_writedata     => m2s.writedata,
+            irq                  => irq,
+            PB                   => '0',
+            SW                   => x"0",
+            LED                  => LED
+        );
+
+    -- Clock driver
+    clock : process is
+    begin
+        clk <= '1';
+        while true loop
+            wait for CLK_PER / 2;
+            clk <= not clk;
+        end loop;
+    end process;
+
+    -- Bus host: poll the C server once per idle cycle, and run each request
+    -- it returns as a single-beat Avalon transfer
+    host : process is
+        variable request : integer;
+        variable data    : std_logic_vector(31 downto 0);
+        variable last    : time;
+        variable irq_bit : integer;
+    begin
+        wait until falling_edge(clk);
+
+        -- Initialization: reset system
+        reset <= '1';
+        m2s   <= AVALON_IDLE;
+        for i in 1 to 5 loop
+            wait until falling_edge(clk);
+        end loop;
+        reset <= '0';
+
+        cosim_start(SYS_CLK_FREQ, LED_WIDTH);
+        last := now;
+        loop
+            wait until falling_edge(clk);
+            if irq then
+                irq_bit := 1;
+            else
+                irq_bit := 0;
+            end if;
+            -- Transfers take several cycles, so count cycles by time
+            request := cosim_poll((now - last) / CLK_PER, to_integer(resize(unsigned(LED), 31)), irq_bit);
+            last    := now;
+            if request = COSIM_READ then
+                avalon_read(clk, m2s, s2m, cosim_address, data);
+                cosim_reply(to_integer(signed(data)));
+            elsif request = COSIM_WRITE then
+                avalon_write(clk, m2s, s2m, cosim_address,
+                             std_logic_vector(to_signed(cosim_writedata, 32)));
+                cosim_reply(0);
+            elsif request = COSIM_QUIT then
+                finish;
+            end if;
+        end loop;
+    end process;
+
+end architecture;
@@ -13,7 +13,10 @@ use ieee.std_logic_unsigned.all;
 entity LED_Patterns is
     generic (
         -- Number of system clock cycles per second
-        SYS_CLKs_sec : unsigned
+        SYS_CLKs_sec : unsigned;
+        -- Number of LEDs; the top one is the heartbeat, and the built-in
+        -- patterns use the rest
+        LED_WIDTH    : positive range 3 to LED_WIDTH_MAX := 8
     );
     port (
         clk             : in    std_logic;
@@ -27,29 +30,66 @@ entity LED_Patterns is
         HPS_LED_control : in    std_logic;
         -- Base transition period, in seconds (UQ4.4)
         Base_rate       : in    unsigned(7 downto 0);
+        -- Base transition period, in system clock cycles, used instead of
+        -- Base_rate unless zero
+        Base_period     : in    unsigned(31 downto 0);
         -- LED register
-        LED_reg         : in    std_logic_vector(7 downto 0);
+        LED_reg         : in    std_logic_vector(LED_WIDTH - 1 downto 0);
+        -- Pattern player start/stop strobes (single-cycle, active high)
+        Player_start    : in    std_logic;
+        Player_stop     : in    std_logic;
+        -- Asserted to restart from Player_first after the last entry
+        Player_loop     : in    std_logic;
+        -- First pattern table entry to play, and number of entries to play
+        Player_first    : in    unsigned(PATTERN_TABLE_BITS - 1 downto 0);
+        Player_length   : in    unsigned(PATTERN_TABLE_BITS downto 0);
+        -- Asserted while the pattern player drives the LEDs
+        Player_busy     : out   std_logic;
+        -- Pattern table entry currently displayed by the player
+        Player_index    : out   unsigned(PATTERN_TABLE_BITS - 1 downto 0);
+        -- Pattern table read port (one cycle of read latency)
+        Table_index     : out   unsigned(PATTERN_TABLE_BITS - 1 downto 0);
+        Table_LED       : in    std_logic_vector(table_led_width(LED_WIDTH) - 1 downto 0);
+        Table_duration  : in    unsigned(PATTERN_DURATION_BITS - 1 downto 0);
+        -- Built-in pattern to select in software, numbered as for Pattern,
+        -- and its load strobe (single-cycle, active high); selecting 0 acts
+        -- like a press of PB
+        Pattern_select  : in    unsigned(2 downto 0);
+        Pattern_load    : in    std_logic;
+        -- Built-in pattern currently selected (0 while showing the switches)
+        Pattern         : out   unsigned(2 downto 0);
         -- LED outputs
-        LED             : out   std_logic_vector(7 downto 0)
+        LED             : out   std_logic_vector(LED_WIDTH - 1 downto 0)
     );
 end entity;
 
 
 architecture LED_Patterns_Arch of LED_Patterns is
 
+    -- Built-in patterns drive every LED below the heartbeat
+    constant PATTERN_WIDTH : positive := LED_WIDTH - 1;
+
     -- Mux-able signal for HW-generated LED pattern
-    signal LED_hw : std_logic_vector(7 downto 0);
+    signal LED_hw : std_logic_vector(LED_WIDTH - 1 downto 0);
 
     -- Pattern generator state machine signals
     signal pattern_clocks : std_logic_vector(0 to 5);
+    -- Shared tick from the clock generator, 16 per Base_rate period
+    signal fine_tick      : std_logic;
 
     type   pattern_t is (SWITCH, SHIFT_RIGHT, SHIFT_LEFT, COUNT_UP, COUNT_DOWN, CUSTOM);
     signal current_pattern, last_pattern : pattern_t;
 
     -- Internal pattern signals
-    type   pattern_array_t is array(natural range <>) of std_logic_vector(6 downto 0);
+    type   pattern_array_t is array(natural range <>) of std_logic_vector(PATTERN_WIDTH - 1 downto 0);
     signal patterns : pattern_array_t(1 to 5);
 
+    -- Pattern player state machine signals
+    type   player_state_t is (IDLE, FETCH, LOAD, PLAY);
+    signal player_state : player_state_t;
+    signal LED_player   : std_logic_vector(LED_WIDTH - 1 downto 0);
+    signal player_next  : unsigned(PATTERN_TABLE_BITS - 1 downto 0);
+
 begin
 
 
@@ -65,70 +105,73 @@ begin
             CLK_SCALES(5) => x"01"
         )
         port map (
-            clk        => clk,
-            reset      => reset,
-            Base_rate  => Base_rate,
-            gen_clocks => pattern_clocks
+            clk         => clk,
+            reset       => reset,
+            Base_rate   => Base_rate,
+            Base_period => Base_period,
+            fine_tick   => fine_tick,
+            gen_clocks  => pattern_clocks
         );
 
 
-    -- Mux between HPS signals and internal pattern, based on HPS control signal
-    with HPS_LED_control select LED <=
-        LED_reg when '1',
-        LED_hw when others;
+    -- Mux between HPS signals, the pattern player and the internal patterns;
+    -- the HPS control signal takes priority over a running player
+    LED <= LED_reg    when HPS_LED_control = '1' else
+           LED_player when player_state /= IDLE else
+           LED_hw;
+
+    -- Expose the pattern state, numbered in pattern_t order
+    Pattern <= to_unsigned(pattern_t'pos(current_pattern), Pattern'length);
 
     -- Mux between internal patterns, based on internal pattern state
-    with current_pattern select LED_hw(6 downto 0) <=
-        b"000" & SW when SWITCH,
+    with current_pattern select LED_hw(PATTERN_WIDTH - 1 downto 0) <=
+        std_logic_vector(resize(unsigned(SW), PATTERN_WIDTH)) when SWITCH,
         patterns(1) when SHIFT_RIGHT,
         patterns(2) when SHIFT_LEFT,
         patterns(3) when COUNT_UP,
         patterns(4) when COUNT_DOWN,
         patterns(5) when CUSTOM,
-        b"1111111"  when others;
+        (others => '1') when others;
 
 
     -- Toggle the "heartbeat" LED every second
     heartbeat : process (pattern_clocks(0), reset) is
     begin
         if reset then
-            LED_hw(7) <= '0';
+            LED_hw(LED_WIDTH - 1) <= '0';
         elsif rising_edge(pattern_clocks(0)) then
-            LED_hw(7) <= not LED_hw(7);
+            LED_hw(LED_WIDTH - 1) <= not LED_hw(LED_WIDTH - 1);
         end if;
     end process;
 
 
     -- Pattern-control state machine
-    -- NOTE: Uses its own counter system, because the required 1-second window
-    -- is asynchronous to the 1-second heartbeat
+    -- PB takes priority over a software selection in the same cycle, and any
+    -- out-of-range selection is ignored
+    -- NOTE: Counts its own window of 16 fine ticks, because the required
+    -- 1-second window is asynchronous to the 1-second heartbeat
     pattern_fsm : process (clk, reset) is
-        variable limit : unsigned(
-                SYS_CLKs_sec'length
-                    + Base_rate'length
-                    - 1
-                downto 0
-            );
-        variable ticks : unsigned(
-                SYS_CLKs_sec'length
-                    + Base_rate'length - 4
-                    - 1
-                downto 0
-            );
+        variable ticks : unsigned(4 downto 0);
     begin
         if reset then
             current_pattern <= SHIFT_RIGHT;
             ticks           := to_unsigned(0, ticks'length);
         elsif rising_edge(clk) then
-            if PB then
+            if PB = '1' or (Pattern_load = '1' and Pattern_select = 0) then
                 current_pattern <= SWITCH;
                 if current_pattern /= SWITCH then
                     last_pattern <= current_pattern;
                 end if;
                 ticks := to_unsigned(0, ticks'length);
+            elsif Pattern_load then
+                if    Pattern_select = 1 then current_pattern <= SHIFT_RIGHT;
+                elsif Pattern_select = 2 then current_pattern <= SHIFT_LEFT;
+                elsif Pattern_select = 3 then current_pattern <= COUNT_UP;
+                elsif Pattern_select = 4 then current_pattern <= COUNT_DOWN;
+                elsif Pattern_select = 5 then current_pattern <= CUSTOM;
+                end if;
             elsif current_pattern = SWITCH then
-                limit := unsigned(Base_rate) * SYS_CLKs_sec;
-                if ticks >= limit(limit'high downto limit'low + 4) - 1 then
+                if ticks = 16 then
                     -- Quartus doesn't like select statements inside of processes,
                     -- even though they should be valid in VHDL-2008
                     if    SW = x"0" then current_pattern <= SHIFT_RIGHT;
@@ -138,7 +181,7 @@ begin
                     elsif SW = x"4" then current_pattern <= CUSTOM;
                     else                 current_pattern <= last_pattern;
                     end if;
-                else
+                elsif fine_tick then
                     ticks := ticks + 1;
                 end if;
             end if;
@@ -146,66 +189,150 @@ begin
     end process;
 
 
+    -- Pattern player state machine
+    -- Plays Player_length table entries starting at Player_first, holding each
+    -- for its duration in Base_rate ticks (a duration of 0 is treated as 1).
+    -- The entry after the one on display is always prefetched, so steps
+    -- change on exact tick boundaries without any table read latency.
+    -- NOTE: Ticks are counted in shared fine ticks, so the first step after a
+    -- start may be up to one fine tick (1/16 of Base_rate) short
+    pattern_player : process (clk, reset) is
+        variable ticks     : unsigned(3 downto 0);
+        variable remaining : unsigned(PATTERN_DURATION_BITS - 1 downto 0);
+        variable played    : unsigned(PATTERN_TABLE_BITS downto 0);
+        variable last_step : boolean;
+        variable advance   : boolean;
+    begin
+        if reset then
+            player_state <= IDLE;
+            player_next  <= (others => '0');
+            Player_index <= (others => '0');
+            LED_player   <= (others => '0');
+            ticks        := to_unsigned(0, ticks'length);
+            remaining    := to_unsigned(0, remaining'length);
+            played       := to_unsigned(0, played'length);
+            last_step    := false;
+        elsif rising_edge(clk) then
+            advance := false;
+            if Player_stop then
+                player_state <= IDLE;
+            elsif Player_start = '1' and Player_length /= 0 then
+                player_next  <= Player_first;
+                played       := to_unsigned(0, played'length);
+                player_state <= FETCH;
+            else
+                case player_state is
+                    when IDLE =>
+                        null;
+                    when FETCH =>
+                        -- Give the table one cycle to present the first entry
+                        player_state <= LOAD;
+                    when LOAD =>
+                        advance := true;
+                    when PLAY =>
+                        if fine_tick then
+                            if ticks = 15 then
+                                ticks := to_unsigned(0, ticks'length);
+                                if remaining > 1 then
+                                    remaining := remaining - 1;
+                                elsif last_step then
+                                    player_state <= IDLE;
+                                else
+                                    advance := true;
+                                end if;
+                            else
+                                ticks := ticks + 1;
+                            end if;
+                        end if;
+                end case;
+            end if;
+
+            -- Display the prefetched entry, and prefetch the one after it
+            if advance then
+                LED_player   <= std_logic_vector(resize(unsigned(Table_LED), LED_WIDTH));
+                Player_index <= player_next;
+                remaining    := Table_duration;
+                ticks        := to_unsigned(0, ticks'length);
+                played       := played + 1;
+                last_step    := false;
+                player_state <= PLAY;
+                if played < Player_length then
+                    player_next <= player_next + 1;
+                elsif Player_loop then
+                    player_next <= Player_first;
+                    played      := to_unsigned(0, played'length);
+                else
+                    last_step := true;
+                end if;
+            end if;
+        end if;
+    end process;
+    Table_index <= player_next;
+    Player_busy <= '0' when player_state = IDLE else '1';
+
+
     -- Pattern-generation state machines
 
     -- One LED, shifting right
     shift_right_pattern : configuration work.PatternRight_Conf
         generic map (
-            WIDTH => 7
+            WIDTH => PATTERN_WIDTH
         )
         port map (
             clk     => pattern_clocks(1),
             reset   => reset,
-            preset  => b"1000000",
+            preset  => std_logic_vector(shift_left(to_unsigned(1, PATTERN_WIDTH), PATTERN_WIDTH - 1)),
             pattern => patterns(1)
         );
 
     -- Two LEDs, shifting left
     shift_left_pattern : configuration work.PatternLeft_Conf
         generic map (
-            WIDTH => 7
+            WIDTH => PATTERN_WIDTH
         )
         port map (
             clk     => pattern_clocks(2),
             reset   => reset,
-            preset  => b"0000011",
+            preset  => std_logic_vector(to_unsigned(3, PATTERN_WIDTH)),
             pattern => patterns(2)
         );
 
     -- Binary up-counter
     count_up_pattern : configuration work.PatternUp_Conf
         generic map (
-            WIDTH => 7
+            WIDTH => PATTERN_WIDTH
         )
         port map (
             clk     => pattern_clocks(3),
             reset   => reset,
-            preset  => b"0000000",
+            preset  => (others => '0'),
             pattern => patterns(3)
         );
 
     -- Binary down-counter
     count_down_pattern : configuration work.PatternDown_Conf
         generic map (
-            WIDTH => 7
+            WIDTH => PATTERN_WIDTH
         )
         port map (
             clk     => pattern_clocks(4),
             reset   => reset,
-            preset  => b"1111111",
+            preset  => (others => '1'),
             pattern => patterns(4)
         );
 
     -- Custom pattern: KITT chaser lights
+    -- NOTE: The generator is one LED wider on each side than the display, so
+    -- that the chaser runs fully off each end before turning around
     kitt_pattern : entity work.PatternGenerator(PatternKITT_Arch)
         generic map (
-            WIDTH => 9
+            WIDTH => PATTERN_WIDTH + 2
         )
         port map (
-            clk                 => pattern_clocks(5),
-            reset               => reset,
-            preset              => b"000000011",
-            pattern(7 downto 1) => patterns(5)
+            clk                             => pattern_clocks(5),
+            reset                           => reset,
+            preset                          => std_logic_vector(to_unsigned(3, PATTERN_WIDTH + 2)),
+            pattern(PATTERN_WIDTH downto 1) => patterns(5)
         );
 
 
@@ -0,0 +1,217 @@
+-- Lucas Ritzdorf
+-- 10/19/2026
+-- EELE 467, LED Patterns
+
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+
+-- Avalon-MM host bus functional model, for driving HPS_LED_Patterns' agent
+-- interface from test benches
+-- NOTE: All procedures start driving immediately, and return just after a
+-- falling clock edge, so they may be called back to back.
+package Avalon_BFM is
+
+    -- Host-to-agent signals
+    type avalon_m2s_t is record
+        read       : std_logic;
+        write      : std_logic;
+        address    : std_logic_vector(9 downto 0);
+        burstcount : std_logic_vector(4 downto 0);
+        byteenable : std_logic_vector(3 downto 0);
+        writedata  : std_logic_vector(31 downto 0);
+    end record;
+
+    -- Agent-to-host signals
+    type avalon_s2m_t is record
+        waitrequest   : std_logic;
+        readdata      : std_logic_vector(31 downto 0);
+        readdatavalid : std_logic;
+    end record;
+
+    constant AVALON_IDLE : avalon_m2s_t := (
+        read       => '0',
+        write      => '0',
+        address    => (others => '0'),
+        burstcount => 5x"1",
+        byteenable => x"F",
+        writedata  => (others => '0')
+    );
+
+    type word_array is array(natural range <>) of std_logic_vector(31 downto 0);
+
+    -- Single-beat write, optionally to a subset of byte lanes
+    procedure avalon_write (
+        signal clk  : in    std_logic;
+        signal m2s  : out   avalon_m2s_t;
+        signal s2m  : in    avalon_s2m_t;
+        addr        : in    natural;
+        data        : in    std_logic_vector(31 downto 0);
+        byteenable  : in    std_logic_vector(3 downto 0) := x"F"
+    );
+
+    -- Single-beat read, waiting for readdatavalid
+    procedure avalon_read (
+        signal clk  : in    std_logic;
+        signal m2s  : out   avalon_m2s_t;
+        signal s2m  : in    avalon_s2m_t;
+        addr        : in    natural;
+        data        : out   std_logic_vector(31 downto 0)
+    );
+
+    -- Burst write of data'length words to consecutive addresses
+    procedure avalon_write_burst (
+        signal clk  : in    std_logic;
+        signal m2s  : out   avalon_m2s_t;
+        signal s2m  : in    avalon_s2m_t;
+        addr        : in    natural;
+        data        : in    word_array
+    );
+
+    -- Burst read of data'length words from consecutive addresses
+    procedure avalon_read_burst (
+        signal clk  : in    std_logic;
+        signal m2s  : out   avalon_m2s_t;
+        signal s2m  : in    avalon_s2m_t;
+        addr        : in    natural;
+        data        : out   word_array
+    );
+
+    -- Back-to-back single-beat reads of consecutive addresses, issuing a new
+    -- read every cycle without waiting for earlier ones to complete
+    procedure avalon_read_pipelined (
+        signal clk  : in    std_logic;
+        signal m2s  : out   avalon_m2s_t;
+        signal s2m  : in    avalon_s2m_t;
+        addr        : in    natural;
+        data        : out   word_array;
+        cycles      : out   natural
+    );
+
+end package;
+
+
+package body Avalon_BFM is
+
+    procedure avalon_write (
+        signal clk  : in    std_logic;
+        signal m2s  : out   avalon_m2s_t;
+        signal s2m  : in    avalon_s2m_t;
+        addr        : in    natural;
+        data        : in    std_logic_vector(31 downto 0);
+        byteenable  : in    std_logic_vector(3 downto 0) := x"F"
+    ) is
+    begin
+        m2s            <= AVALON_IDLE;
+        m2s.write      <= '1';
+        m2s.address    <= std_logic_vector(to_unsigned(addr, m2s.address'length));
+        m2s.byteenable <= byteenable;
+        m2s.writedata  <= data;
+        loop
+            wait until rising_edge(clk);
+            exit when s2m.waitrequest = '0';
+        end loop;
+        wait until falling_edge(clk);
+        m2s <= AVALON_IDLE;
+    end procedure;
+
+    procedure avalon_read (
+        signal clk  : in    std_logic;
+        signal m2s  : out   avalon_m2s_t;
+        signal s2m  : in    avalon_s2m_t;
+        addr        : in    natural;
+        data        : out   std_logic_vector(31 downto 0)
+    ) is
+        variable words : word_array(0 to 0);
+    begin
+        avalon_read_burst(clk, m2s, s2m, addr, words);
+        data := words(0);
+    end procedure;
+
+    procedure avalon_write_burst (
+        signal clk  : in    std_logic;
+        signal m2s  : out   avalon_m2s_t;
+        signal s2m  : in    avalon_s2m_t;
+        addr        : in    natural;
+        data        : in    word_array
+    ) is
+    begin
+        m2s            <= AVALON_IDLE;
+        m2s.address    <= std_logic_vector(to_unsigned(addr, m2s.address'length));
+        m2s.burstcount <= std_logic_vector(to_unsigned(data'length, m2s.burstcount'length));
+        for i in data'range loop
+            m2s.write     <= '1';
+            m2s.writedata <= data(i);
+            loop
+                wait until rising_edge(clk);
+                exit when s2m.waitrequest = '0';
+            end loop;
+            wait until falling_edge(clk);
+        end loop;
+        m2s <= AVALON_IDLE;
+    end procedure;
+
+    procedure avalon_read_burst (
+        signal clk  : in    std_logic;
+        signal m2s  : out   avalon_m2s_t;
+        signal s2m  : in    avalon_s2m_t;
+        addr        : in    natural;
+        data        : out   word_array
+    ) is
+        variable received : natural := 0;
+    begin
+        m2s            <= AVALON_IDLE;
+        m2s.read       <= '1';
+        m2s.address    <= std_logic_vector(to_unsigned(addr, m2s.address'length));
+        m2s.burstcount <= std_logic_vector(to_unsigned(data'length, m2s.burstcount'length));
+        loop
+            wait until rising_edge(clk);
+            exit when s2m.waitrequest = '0';
+        end loop;
+        wait until falling_edge(clk);
+        m2s <= AVALON_IDLE;
+        while received < data'length loop
+            wait until rising_edge(clk);
+            if s2m.readdatavalid = '1' then
+                data(data'low + received) := s2m.readdata;
+                received                  := received + 1;
+            end if;
+        end loop;
+        wait until falling_edge(clk);
+    end procedure;
+
+    procedure avalon_read_pipelined (
+        signal clk  : in    std_logic;
+        signal m2s  : out   avalon_m2s_t;
+        signal s2m  : in    avalon_s2m_t;
+        addr        : in    natural;
+        data        : out   word_array;
+        cycles      : out   natural
+    ) is
+        variable issued, received, elapsed : natural := 0;
+    begin
+        m2s <= AVALON_IDLE;
+        while received < data'length loop
+            if issued < data'length then
+                m2s.read    <= '1';
+                m2s.address <= std_logic_vector(to_unsigned(addr + issued, m2s.address'length));
+            else
+                m2s.read <= '0';
+            end if;
+            wait until rising_edge(clk);
+            elapsed := elapsed + 1;
+            if s2m.readdatavalid = '1' then
+                data(data'low + received) := s2m.readdata;
+                received                  := received + 1;
+            end if;
+            if issued < data'length and s2m.waitrequest = '0' then
+                issued := issued + 1;
+            end if;
+            wait until falling_edge(clk);
+        end loop;
+        m2s    <= AVALON_IDLE;
+        cycles := elapsed;
+    end procedure;
+
+end package body;
@@ -0,0 +1,147 @@
+-- Lucas Ritzdorf
+-- 10/19/2026
+-- EELE 467, LED Patterns
+
+use std.env.all;
+use work.common.all;
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+use ieee.std_logic_unsigned.all;
+
+
+-- ClockGenerator test bench
+entity ClockGenerator_TB is
+end entity;
+
+architecture ClockGenerator_TB_Arch of ClockGenerator_TB is
+    constant CLK_PER : time := 20 ns;
+    -- Scaled-down clock rate, so that a Base_rate of 1/16 second gives one
+    -- fine tick every 10 cycles
+    constant SYS_CLK_FREQ : natural := 2560;
+    constant CLK_SCALES   : byte_2d := (x"10", x"08", x"04", x"20", x"02", x"01");
+
+    signal clk,       reset      : std_logic;
+    signal Base_rate             : unsigned(7 downto 0);
+    signal Base_period           : unsigned(31 downto 0);
+    signal fine_tick             : std_logic;
+    signal gen_clocks            : std_logic_vector(CLK_SCALES'range);
+begin
+
+    -- ClockGenerator DUT instance
+    dut : entity work.ClockGenerator
+        generic map (
+            SYS_CLKs_sec => to_unsigned(SYS_CLK_FREQ, 12),
+            CLK_SCALES   => CLK_SCALES
+        )
+        port map (
+            clk         => clk,
+            reset       => reset,
+            Base_rate   => Base_rate,
+            Base_period => Base_period,
+            fine_tick   => fine_tick,
+            gen_clocks  => gen_clocks
+        );
+
+    -- Clock driver
+    clock : process is
+    begin
+        clk <= '1';
+        while true loop
+            wait for CLK_PER / 2;
+            clk <= not clk;
+        end loop;
+    end process;
+
+    -- Test driver
+    tester : process is
+
+        -- Measure the number of cycles between two pulses of a clock output,
+        -- and compare it against the ideal period
+        -- (CLK_SCALES * Base_rate * SYS_CLK_FREQ / 256 cycles, or
+        -- CLK_SCALES * Base_period / 16 cycles)
+        procedure check_period (n : natural) is
+            variable cycles   : natural;
+            variable expected : natural;
+        begin
+            if Base_period /= 0 then
+                expected := to_integer(unsigned(CLK_SCALES(n)))
+                    * to_integer(Base_period) / 16;
+            else
+                expected := to_integer(unsigned(CLK_SCALES(n)))
+                    * to_integer(Base_rate) * SYS_CLK_FREQ / 256;
+            end if;
+            wait until falling_edge(clk) and gen_clocks(n) = '1';
+            cycles := 0;
+            loop
+                wait until falling_edge(clk);
+                cycles := cycles + 1;
+                exit when gen_clocks(n) = '1';
+            end loop;
+            assert cycles = expected
+                report "Clock " & integer'image(n) & " period was "
+                    & integer'image(cycles) & " cycles, expected "
+                    & integer'image(expected)
+                severity error;
+        end procedure;
+
+    begin
+        wait until falling_edge(clk);
+
+        -- Initialization: reset system
+        reset       <= '1';
+        Base_rate   <= x"01";
+        Base_period <= (others => '0');
+        for i in 1 to 5 loop
+            wait until falling_edge(clk);
+        end loop;
+        reset <= '0';
+
+        -- Fastest Base_rate: a fine tick every 10 cycles
+        for n in CLK_SCALES'range loop
+            check_period(n);
+        end loop;
+
+        -- Fractional Base_rate (1.5 s): a fine tick every 240 cycles; the new
+        -- product takes a few cycles to compute, so skip the first pulse
+        Base_rate <= x"18";
+        wait until falling_edge(clk) and gen_clocks(5) = '1';
+        for n in CLK_SCALES'range loop
+            check_period(n);
+        end loop;
+
+        -- Base_period of 32 cycles: a fine tick every 2 cycles, which
+        -- Base_rate can't express; it takes effect on the next cycle
+        Base_period <= to_unsigned(32, 32);
+        wait until falling_edge(clk) and gen_clocks(5) = '1';
+        for n in CLK_SCALES'range loop
+            check_period(n);
+        end loop;
+
+        -- Switching back recomputes the Base_rate product, even though
+        -- Base_rate itself hasn't changed
+        Base_period <= (others => '0');
+        for i in 1 to 20 loop
+            wait until falling_edge(clk);
+        end loop;
+        wait until falling_edge(clk) and gen_clocks(5) = '1';
+        for n in CLK_SCALES'range loop
+            check_period(n);
+        end loop;
+
+        -- A zero Base_rate stops every clock
+        Base_rate <= x"00";
+        for i in 1 to 20 loop
+            wait until falling_edge(clk);
+        end loop;
+        for i in 1 to 1000 loop
+            wait until falling_edge(clk);
+            assert gen_clocks = "000000" and fine_tick = '0'
+                report "Clocks kept running with a zero Base_rate"
+                severity error;
+        end loop;
+
+        finish;
+    end process;
+
+end architecture;
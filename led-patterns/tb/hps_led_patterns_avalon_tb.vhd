@@ -0,0 +1,326 @@
+-- Lucas Ritzdorf
+-- 10/19/2026
+-- EELE 467, LED Patterns
+
+use std.env.all;
+use work.common.all;
+use work.Avalon_BFM.all;
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+use ieee.std_logic_unsigned.all;
+
+
+-- HPS_LED_Patterns Avalon interface test bench
+entity HPS_LED_Patterns_Avalon_TB is
+end entity;
+
+architecture HPS_LED_Patterns_Avalon_TB_Arch of HPS_LED_Patterns_Avalon_TB is
+    constant CLK_PER : time := 20 ns;
+
+    -- Register word addresses
+    constant LED_REG_ADDR       : natural := 1;
+    constant BASE_RATE_ADDR     : natural := 2;
+    constant PLAYER_LENGTH_ADDR : natural := 6;
+    constant CAPABILITIES_ADDR  : natural := 12;
+    constant COUNTER_LO_ADDR    : natural := 13;
+    constant COUNTER_HI_ADDR    : natural := 14;
+    constant CLOCK_FREQ_ADDR    : natural := 15;
+    constant BASE_PERIOD_ADDR   : natural := 22;
+    constant STAMP_ADDR         : natural := 16#040#;
+    constant LED_WINDOW_ADDR    : natural := 16#080#;
+    constant TABLE_ADDR         : natural := 16#100#;
+    constant BRIGHTNESS_ADDR    : natural := 16#200#;
+    constant GAMMA_ADDR         : natural := 16#300#;
+
+    signal clk, reset : std_logic;
+    signal m2s        : avalon_m2s_t;
+    signal s2m        : avalon_s2m_t;
+    signal LED        : std_logic_vector(7 downto 0);
+
+    -- Second instance, with more LEDs than fit in one word
+    signal m2s_wide : avalon_m2s_t;
+    signal s2m_wide : avalon_s2m_t;
+    signal LED_wide : std_logic_vector(39 downto 0);
+begin
+
+    -- HPS_LED_Patterns DUT instance
+    dut : entity work.HPS_LED_Patterns
+        generic map (
+            SYS_CLK_FREQ => 2560
+        )
+        port map (
+            clk                  => clk,
+            reset                => reset,
+            avs_s1_read          => m2s.read,
+            avs_s1_write         => m2s.write,
+            avs_s1_address       => m2s.address,
+            avs_s1_burstcount    => m2s.burstcount,
+            avs_s1_byteenable    => m2s.byteenable,
+            avs_s1_waitrequest   => s2m.waitrequest,
+            avs_s1_readdata      => s2m.readdata,
+            avs_s1_readdatavalid => s2m.readdatavalid,
+            avs_s1_writedata     => m2s.writedata,
+            PB                   => '0',
+            SW                   => x"0",
+            LED                  => LED
+        );
+
+    -- Wide HPS_LED_Patterns DUT instance
+    dut_wide : entity work.HPS_LED_Patterns
+        generic map (
+            SYS_CLK_FREQ => 2560,
+            LED_WIDTH    => 40
+        )
+        port map (
+            clk                  => clk,
+            reset                => reset,
+            avs_s1_read          => m2s_wide.read,
+            avs_s1_write         => m2s_wide.write,
+            avs_s1_address       => m2s_wide.address,
+            avs_s1_burstcount    => m2s_wide.burstcount,
+            avs_s1_byteenable    => m2s_wide.byteenable,
+            avs_s1_waitrequest   => s2m_wide.waitrequest,
+            avs_s1_readdata      => s2m_wide.readdata,
+            avs_s1_readdatavalid => s2m_wide.readdatavalid,
+            avs_s1_writedata     => m2s_wide.writedata,
+            PB                   => '0',
+            SW                   => x"0",
+            LED                  => LED_wide
+        );
+
+    -- Clock driver
+    clock : process is
+    begin
+        clk <= '1';
+        while true loop
+            wait for CLK_PER / 2;
+            clk <= not clk;
+        end loop;
+    end process;
+
+    -- Test driver
+    tester : process is
+        variable data   : std_logic_vector(31 downto 0);
+        variable table  : word_array(0 to 15);
+        variable words  : word_array(0 to 15);
+        variable regs   : word_array(0 to 2);
+        variable cycles : natural;
+        variable c0, c1 : unsigned(31 downto 0);
+    begin
+        wait until falling_edge(clk);
+
+        -- Initialization: reset system
+        reset    <= '1';
+        m2s      <= AVALON_IDLE;
+        m2s_wide <= AVALON_IDLE;
+        for i in 1 to 5 loop
+            wait until falling_edge(clk);
+        end loop;
+        reset <= '0';
+        wait until falling_edge(clk);
+
+        -- Single-beat write and read
+        avalon_write(clk, m2s, s2m, LED_REG_ADDR, x"000000A5");
+        avalon_read(clk, m2s, s2m, LED_REG_ADDR, data);
+        assert data = x"000000A5"
+            report "Single-beat read returned wrong LED_reg value"
+            severity error;
+
+        -- Byte enables: a write that skips byte lane 0 leaves LED_reg alone
+        avalon_write(clk, m2s, s2m, LED_REG_ADDR, x"0000005A", "1110");
+        avalon_read(clk, m2s, s2m, LED_REG_ADDR, data);
+        assert data = x"000000A5"
+            report "Write without byte lane 0 modified LED_reg"
+            severity error;
+
+        -- Byte enables on the pattern table: update only the upper byte of a
+        -- duration
+        avalon_write(clk, m2s, s2m, TABLE_ADDR + 1, x"00001234");
+        avalon_write(clk, m2s, s2m, TABLE_ADDR + 1, x"0000AB00", "0010");
+        avalon_read(clk, m2s, s2m, TABLE_ADDR + 1, data);
+        assert data = x"0000AB34"
+            report "Partial pattern table write failed"
+            severity error;
+
+        -- Burst write eight table entries, then burst read them back
+        for i in table'range loop
+            if i mod 2 = 0 then
+                table(i) := std_logic_vector(to_unsigned(16#10# + i, 32));
+            else
+                table(i) := std_logic_vector(to_unsigned(100 * i, 32));
+            end if;
+        end loop;
+        avalon_write_burst(clk, m2s, s2m, TABLE_ADDR + 16, table);
+        avalon_read_burst(clk, m2s, s2m, TABLE_ADDR + 16, words);
+        for i in table'range loop
+            assert words(i) = table(i)
+                report "Burst read mismatch at word " & integer'image(i)
+                severity error;
+        end loop;
+
+        -- Burst read of the control registers
+        avalon_write(clk, m2s, s2m, BASE_RATE_ADDR, x"00000018");
+        avalon_read_burst(clk, m2s, s2m, LED_REG_ADDR, regs);
+        assert regs(0) = x"000000A5" and regs(1) = x"00000018" and regs(2) = x"00000000"
+            report "Register burst read mismatch"
+            severity error;
+
+        -- Pipelined single-beat reads: one result per cycle, plus one cycle
+        -- of latency
+        avalon_read_pipelined(clk, m2s, s2m, TABLE_ADDR + 16, words, cycles);
+        for i in table'range loop
+            assert words(i) = table(i)
+                report "Pipelined read mismatch at word " & integer'image(i)
+                severity error;
+        end loop;
+        assert cycles = words'length + 1
+            report "Pipelined reads took " & integer'image(cycles) & " cycles"
+            severity error;
+
+        -- A read burst holds off the next command until its last beat issues
+        m2s.read       <= '1';
+        m2s.address    <= std_logic_vector(to_unsigned(TABLE_ADDR, m2s.address'length));
+        m2s.burstcount <= 5x"4";
+        wait until rising_edge(clk);
+        assert s2m.waitrequest = '0'
+            severity error;
+        wait until falling_edge(clk);
+        m2s <= AVALON_IDLE;
+        for i in 1 to 3 loop
+            assert s2m.waitrequest = '1'
+                report "waitrequest not asserted during read burst"
+                severity error;
+            wait until falling_edge(clk);
+        end loop;
+        assert s2m.waitrequest = '0'
+            report "waitrequest held after read burst"
+            severity error;
+
+        -- Registers still behave after the burst traffic
+        avalon_write(clk, m2s, s2m, PLAYER_LENGTH_ADDR, x"00000080");
+        avalon_read(clk, m2s, s2m, PLAYER_LENGTH_ADDR, data);
+        assert data = x"00000080"
+            report "Player_length did not read back"
+            severity error;
+
+        -- The capability register reports 8 LEDs and a 128-entry table
+        avalon_read(clk, m2s, s2m, CAPABILITIES_ADDR, data);
+        assert data = x"1F070008"
+            report "Capability register mismatch"
+            severity error;
+
+        -- The cycle counter runs at the system clock rate, and a write is
+        -- stamped with the count at the edge it lands on. Single-beat reads
+        -- take two cycles and writes one, so the write below lands four
+        -- cycles after the first Counter_lo read, and the second read five.
+        avalon_read(clk, m2s, s2m, CLOCK_FREQ_ADDR, data);
+        assert to_integer(unsigned(data)) = 2560
+            report "Clock_freq mismatch"
+            severity error;
+        avalon_read(clk, m2s, s2m, COUNTER_LO_ADDR, data);
+        c0 := unsigned(data);
+        avalon_read(clk, m2s, s2m, COUNTER_HI_ADDR, data);
+        assert data = x"00000000"
+            report "Counter_hi nonzero shortly after reset"
+            severity error;
+        avalon_write(clk, m2s, s2m, LED_REG_ADDR, x"000000A5");
+        avalon_read(clk, m2s, s2m, COUNTER_LO_ADDR, data);
+        c1 := unsigned(data);
+        assert c1 - c0 = 5
+            report "Cycle counter advanced by " & integer'image(to_integer(c1 - c0))
+            severity error;
+        avalon_read(clk, m2s, s2m, STAMP_ADDR + 2 * LED_REG_ADDR, data);
+        assert unsigned(data) - c0 = 4
+            report "LED_reg write stamped " & integer'image(to_integer(unsigned(data) - c0)) & " cycles after Counter_lo read"
+            severity error;
+        avalon_read(clk, m2s, s2m, STAMP_ADDR + 2 * LED_REG_ADDR + 1, data);
+        assert data = x"00000000"
+            report "Write timestamp high word mismatch"
+            severity error;
+
+        -- Base_period reads back, and a Base_rate write clears it
+        avalon_write(clk, m2s, s2m, BASE_PERIOD_ADDR, x"00012345");
+        avalon_read(clk, m2s, s2m, BASE_PERIOD_ADDR, data);
+        assert data = x"00012345"
+            report "Base_period did not read back"
+            severity error;
+        -- Registers past word 15 are stamped too
+        avalon_read(clk, m2s, s2m, STAMP_ADDR + 2 * BASE_PERIOD_ADDR, data);
+        assert unsigned(data) > c1
+            report "Base_period write not stamped"
+            severity error;
+        -- Base_period honours byte lanes: writes to its upper bytes alone
+        -- keep the low byte, and a low byte write keeps the upper ones
+        avalon_write(clk, m2s, s2m, BASE_PERIOD_ADDR, x"ABCD6789", "1100");
+        avalon_read(clk, m2s, s2m, BASE_PERIOD_ADDR, data);
+        assert data = x"ABCD2345"
+            report "Base_period upper byte lane write mismatch"
+            severity error;
+        avalon_write(clk, m2s, s2m, BASE_PERIOD_ADDR, x"000000EF", "0001");
+        avalon_read(clk, m2s, s2m, BASE_PERIOD_ADDR, data);
+        assert data = x"ABCD23EF"
+            report "Base_period low byte lane write mismatch"
+            severity error;
+        avalon_write(clk, m2s, s2m, BASE_RATE_ADDR, x"00000010");
+        avalon_read(clk, m2s, s2m, BASE_PERIOD_ADDR, data);
+        assert data = x"00000000"
+            report "Base_rate write did not clear Base_period"
+            severity error;
+
+        -- Brightness starts out full and honours byte lanes, bytes past the
+        -- last LED read as zero, and the gamma table starts out as a 2.2
+        -- power curve
+        avalon_read(clk, m2s, s2m, BRIGHTNESS_ADDR + 1, data);
+        assert data = x"FFFFFFFF"
+            report "Brightness not full after reset"
+            severity error;
+        avalon_write(clk, m2s, s2m, BRIGHTNESS_ADDR + 1, x"12345678", "0101");
+        avalon_read(clk, m2s, s2m, BRIGHTNESS_ADDR + 1, data);
+        assert data = x"FF34FF78"
+            report "Brightness byte lane write mismatch"
+            severity error;
+        avalon_read(clk, m2s, s2m, BRIGHTNESS_ADDR + 2, data);
+        assert data = x"00000000"
+            report "Brightness past the last LED nonzero"
+            severity error;
+        avalon_read(clk, m2s, s2m, GAMMA_ADDR + 128, data);
+        assert data = x"00000038"
+            report "Default gamma table mismatch"
+            severity error;
+        avalon_write(clk, m2s, s2m, GAMMA_ADDR + 128, x"00000099");
+        avalon_read(clk, m2s, s2m, GAMMA_ADDR + 128, data);
+        assert data = x"00000099"
+            report "Gamma table entry did not read back"
+            severity error;
+        avalon_read(clk, m2s, s2m, GAMMA_ADDR + 255, data);
+        assert data = x"000000FF"
+            report "Gamma table top entry not full"
+            severity error;
+
+        -- A 40-LED instance reports its width, and maps its LEDs across two
+        -- words, the first aliased by LED_reg
+        avalon_read(clk, m2s_wide, s2m_wide, CAPABILITIES_ADDR, data);
+        assert data = x"1F070028"
+            report "Wide capability register mismatch"
+            severity error;
+        avalon_write(clk, m2s_wide, s2m_wide, LED_REG_ADDR, x"12345678");
+        avalon_write(clk, m2s_wide, s2m_wide, LED_WINDOW_ADDR + 1, x"FFFFFFA5");
+        avalon_read(clk, m2s_wide, s2m_wide, LED_WINDOW_ADDR, data);
+        assert data = x"12345678"
+            report "LED window did not alias LED_reg"
+            severity error;
+        avalon_read(clk, m2s_wide, s2m_wide, LED_WINDOW_ADDR + 1, data);
+        assert data = x"000000A5"
+            report "Upper LED word did not read back (or kept nonexistent LEDs)"
+            severity error;
+        avalon_write(clk, m2s_wide, s2m_wide, 0, x"00000001");
+        wait until falling_edge(clk);
+        assert LED_wide = x"A512345678"
+            report "Wide LED outputs did not follow LED_reg"
+            severity error;
+
+        finish;
+    end process;
+
+end architecture;
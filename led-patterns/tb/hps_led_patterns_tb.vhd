@@ -0,0 +1,463 @@
+-- Lucas Ritzdorf
+-- 10/19/2026
+-- EELE 467, LED Patterns
+
+use std.env.all;
+use work.common.all;
+use work.Avalon_BFM.all;
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+use ieee.std_logic_unsigned.all;
+
+
+-- HPS_LED_Patterns test bench
+entity HPS_LED_Patterns_TB is
+end entity;
+
+architecture HPS_LED_Patterns_TB_Arch of HPS_LED_Patterns_TB is
+    constant CLK_PER : time := 20 ns;
+    -- Scaled-down clock rate, so that one Base_rate tick of 1/16 second
+    -- lasts exactly TICK_CYCLES clock cycles (16 fine ticks of 10 cycles)
+    constant SYS_CLK_FREQ : natural := 2560;
+    constant TICK_CYCLES  : natural := 160;
+
+    -- Register word addresses
+    constant LED_REG_ADDR        : natural := 1;
+    constant BASE_RATE_ADDR      : natural := 2;
+    constant PLAYER_CTRL_ADDR    : natural := 3;
+    constant PLAYER_LOOP_ADDR    : natural := 4;
+    constant PLAYER_FIRST_ADDR   : natural := 5;
+    constant PLAYER_LENGTH_ADDR  : natural := 6;
+    constant IRQ_STATUS_ADDR     : natural := 8;
+    constant IRQ_MASK_ADDR       : natural := 9;
+    constant IRQ_RAISE_ADDR      : natural := 10;
+    constant EVENT_STATE_ADDR    : natural := 11;
+    constant FIFO_CONTROL_ADDR   : natural := 16;
+    constant FIFO_LEVEL_ADDR     : natural := 17;
+    constant FIFO_STATUS_ADDR    : natural := 18;
+    constant FIFO_WATERMARK_ADDR : natural := 19;
+    constant FIFO_DEPTH_ADDR     : natural := 20;
+    constant PATTERN_SELECT_ADDR : natural := 21;
+    constant FIFO_ADDR           : natural := 16#070#;
+    constant TABLE_ADDR          : natural := 16#100#;
+    constant BRIGHTNESS_ADDR     : natural := 16#200#;
+    constant GAMMA_ADDR          : natural := 16#300#;
+    -- Cycles per PWM period, which at this clock rate steps every cycle
+    constant PWM_CYCLES          : natural := 255;
+
+    signal clk, reset : std_logic;
+    signal m2s        : avalon_m2s_t;
+    signal s2m        : avalon_s2m_t;
+    signal PB         : std_logic;
+    signal SW         : std_logic_vector(3 downto 0);
+    signal LED        : std_logic_vector(7 downto 0);
+    signal irq        : std_logic;
+begin
+
+    -- HPS_LED_Patterns DUT instance
+    dut : entity work.HPS_LED_Patterns
+        generic map (
+            SYS_CLK_FREQ => SYS_CLK_FREQ
+        )
+        port map (
+            clk                  => clk,
+            reset                => reset,
+            avs_s1_read          => m2s.read,
+            avs_s1_write         => m2s.write,
+            avs_s1_address       => m2s.address,
+            avs_s1_burstcount    => m2s.burstcount,
+            avs_s1_byteenable    => m2s.byteenable,
+            avs_s1_waitrequest   => s2m.waitrequest,
+            avs_s1_readdata      => s2m.readdata,
+            avs_s1_readdatavalid => s2m.readdatavalid,
+            avs_s1_writedata     => m2s.writedata,
+            irq                  => irq,
+            PB                   => PB,
+            SW                   => SW,
+            LED                  => LED
+        );
+
+    -- Clock driver
+    clock : process is
+    begin
+        clk <= '1';
+        while true loop
+            wait for CLK_PER / 2;
+            clk <= not clk;
+        end loop;
+    end process;
+
+    -- Test driver
+    tester : process is
+
+        -- Single-beat Avalon accesses, via the bus functional model
+        procedure write_reg (addr : natural; data : natural) is
+        begin
+            avalon_write(clk, m2s, s2m, addr, std_logic_vector(to_unsigned(data, 32)));
+        end procedure;
+
+        procedure read_reg (addr : natural; data : out std_logic_vector(31 downto 0)) is
+        begin
+            avalon_read(clk, m2s, s2m, addr, data);
+        end procedure;
+
+        procedure wait_cycles (n : natural) is
+        begin
+            for i in 1 to n loop
+                wait until falling_edge(clk);
+            end loop;
+        end procedure;
+
+        -- Count the cycles each LED is lit over one PWM period
+        procedure measure_duty (lit : out integer_vector(0 to 7)) is
+        begin
+            lit := (others => 0);
+            for i in 1 to PWM_CYCLES loop
+                wait until falling_edge(clk);
+                for n in lit'range loop
+                    if LED(n) = '1' then
+                        lit(n) := lit(n) + 1;
+                    end if;
+                end loop;
+            end loop;
+        end procedure;
+
+        -- Wait for the LEDs to show a value, counting the cycles taken
+        procedure wait_for_led (value : std_logic_vector(7 downto 0); cycles : out natural) is
+            variable n : natural := 0;
+        begin
+            while LED /= value and n < 1000 loop
+                wait until falling_edge(clk);
+                n := n + 1;
+            end loop;
+            cycles := n;
+        end procedure;
+
+        variable data    : std_logic_vector(31 downto 0);
+        variable entries : word_array(0 to 7);
+        variable cycles  : natural;
+        variable depth   : natural;
+        variable lit     : integer_vector(0 to 7);
+
+    begin
+        wait until falling_edge(clk);
+
+        -- Initialization: reset system
+        reset <= '1';
+        m2s   <= AVALON_IDLE;
+        PB    <= '0';
+        SW    <= x"0";
+        wait_cycles(5);
+        reset <= '0';
+        wait until falling_edge(clk);
+
+        -- Fastest Base_rate, so each tick lasts TICK_CYCLES cycles
+        write_reg(BASE_RATE_ADDR, 16#01#);
+
+        -- Upload a three-entry table at entries 5 through 7
+        write_reg(TABLE_ADDR + 2 * 5,     16#81#);
+        write_reg(TABLE_ADDR + 2 * 5 + 1, 1);
+        write_reg(TABLE_ADDR + 2 * 6,     16#42#);
+        write_reg(TABLE_ADDR + 2 * 6 + 1, 2);
+        write_reg(TABLE_ADDR + 2 * 7,     16#24#);
+        write_reg(TABLE_ADDR + 2 * 7 + 1, 1);
+
+        -- Table contents should read back
+        read_reg(TABLE_ADDR + 2 * 6, data);
+        assert data = x"00000042"
+            report "Pattern table LED value did not read back"
+            severity error;
+        read_reg(TABLE_ADDR + 2 * 6 + 1, data);
+        assert data = x"00000002"
+            report "Pattern table duration did not read back"
+            severity error;
+
+        -- Play the table once through
+        write_reg(PLAYER_LOOP_ADDR, 0);
+        write_reg(PLAYER_FIRST_ADDR, 5);
+        write_reg(PLAYER_LENGTH_ADDR, 3);
+        write_reg(PLAYER_CTRL_ADDR, 1);
+        -- The first entry appears three cycles after the start strobe is
+        -- written, and lasts up to one fine tick less than its duration; each
+        -- later entry lasts exactly its duration. Check each mid-step.
+        wait_cycles(TICK_CYCLES / 2);
+        assert LED = x"81"
+            report "Player did not display first entry"
+            severity error;
+        wait_cycles(TICK_CYCLES);
+        assert LED = x"42"
+            report "Player did not display second entry"
+            severity error;
+        wait_cycles(2 * TICK_CYCLES);
+        assert LED = x"24"
+            report "Player did not display third entry"
+            severity error;
+        wait_cycles(TICK_CYCLES);
+        read_reg(PLAYER_CTRL_ADDR, data);
+        assert data(0) = '0'
+            report "Player did not stop after the last entry"
+            severity error;
+        assert LED /= x"24"
+            report "Player did not release the LEDs"
+            severity error;
+
+        -- Play the table in a loop, and check that it wraps around
+        write_reg(PLAYER_LOOP_ADDR, 1);
+        write_reg(PLAYER_CTRL_ADDR, 1);
+        wait_cycles(TICK_CYCLES / 2 + 4 * TICK_CYCLES);
+        assert LED = x"81"
+            report "Player did not wrap to first entry"
+            severity error;
+        read_reg(PLAYER_CTRL_ADDR, data);
+        assert data(0) = '1'
+            report "Player not busy while looping"
+            severity error;
+
+        -- Software override takes priority over the player
+        write_reg(0, 1);
+        write_reg(LED_REG_ADDR, 16#3C#);
+        wait until falling_edge(clk);
+        assert LED = x"3C"
+            report "HPS_LED_control did not override the player"
+            severity error;
+        write_reg(0, 0);
+
+        -- Stop the player
+        write_reg(PLAYER_CTRL_ADDR, 2);
+        wait until falling_edge(clk);
+        read_reg(PLAYER_CTRL_ADDR, data);
+        assert data(0) = '0'
+            report "Player did not stop on request"
+            severity error;
+
+        -- Interrupts: acknowledge anything latched so far, then enable all
+        write_reg(IRQ_STATUS_ADDR, 16#7#);
+        wait until falling_edge(clk);
+        read_reg(IRQ_STATUS_ADDR, data);
+        assert data = x"00000000"
+            report "IRQ_status did not clear"
+            severity error;
+        assert irq = '0'
+            report "irq asserted with nothing pending"
+            severity error;
+        write_reg(IRQ_MASK_ADDR, 16#7#);
+
+        -- A switch change raises an interrupt once synchronized
+        SW <= x"3";
+        wait_cycles(4);
+        assert irq = '1'
+            report "Switch change did not raise irq"
+            severity error;
+        read_reg(IRQ_STATUS_ADDR, data);
+        assert data = x"00000002"
+            report "Switch change not flagged in IRQ_status"
+            severity error;
+        read_reg(EVENT_STATE_ADDR, data);
+        assert data(3 downto 0) = x"3"
+            report "Event_state did not report the switches"
+            severity error;
+        write_reg(IRQ_STATUS_ADDR, 16#2#);
+        wait until falling_edge(clk);
+        assert irq = '0'
+            report "irq held after acknowledgement"
+            severity error;
+
+        -- A button press flags itself, and the switch to the SWITCH pattern
+        PB <= '1';
+        wait until falling_edge(clk);
+        PB <= '0';
+        wait_cycles(2);
+        read_reg(IRQ_STATUS_ADDR, data);
+        assert data = x"00000005"
+            report "Button press not flagged in IRQ_status"
+            severity error;
+        read_reg(EVENT_STATE_ADDR, data);
+        assert data(6 downto 4) = "000"
+            report "Event_state did not report the SWITCH pattern"
+            severity error;
+        write_reg(IRQ_STATUS_ADDR, 16#7#);
+
+        -- One second later, the switches select COUNT_DOWN
+        wait_cycles(TICK_CYCLES + 10);
+        read_reg(IRQ_STATUS_ADDR, data);
+        assert data = x"00000004"
+            report "Pattern change not flagged in IRQ_status"
+            severity error;
+        read_reg(EVENT_STATE_ADDR, data);
+        assert data(6 downto 4) = "100"
+            report "Event_state did not report the COUNT_DOWN pattern"
+            severity error;
+        write_reg(IRQ_STATUS_ADDR, 16#7#);
+
+        -- Simulated events latch like real ones, but only enabled ones
+        -- assert irq
+        write_reg(IRQ_MASK_ADDR, 16#1#);
+        write_reg(IRQ_RAISE_ADDR, 16#2#);
+        wait until falling_edge(clk);
+        read_reg(IRQ_STATUS_ADDR, data);
+        assert data = x"00000002"
+            report "IRQ_raise did not latch an event"
+            severity error;
+        assert irq = '0'
+            report "Masked event raised irq"
+            severity error;
+        write_reg(IRQ_MASK_ADDR, 16#3#);
+        wait until falling_edge(clk);
+        assert irq = '1'
+            report "Unmasking a pending event did not raise irq"
+            severity error;
+        write_reg(IRQ_STATUS_ADDR, 16#2#);
+        wait until falling_edge(clk);
+        assert irq = '0'
+            report "irq held after acknowledging a simulated event"
+            severity error;
+
+        -- Software selects a built-in pattern directly, flagging the change
+        -- like any other; out-of-range selections are ignored
+        write_reg(IRQ_STATUS_ADDR, 16#7#);
+        write_reg(PATTERN_SELECT_ADDR, 3);
+        wait until falling_edge(clk);
+        read_reg(PATTERN_SELECT_ADDR, data);
+        assert data = x"00000003"
+            report "Pattern_select did not select COUNT_UP"
+            severity error;
+        read_reg(IRQ_STATUS_ADDR, data);
+        assert data = x"00000004"
+            report "Selecting a pattern not flagged in IRQ_status"
+            severity error;
+        write_reg(PATTERN_SELECT_ADDR, 7);
+        wait until falling_edge(clk);
+        read_reg(EVENT_STATE_ADDR, data);
+        assert data(6 downto 4) = "011"
+            report "Out-of-range Pattern_select changed the pattern"
+            severity error;
+        write_reg(PATTERN_SELECT_ADDR, 5);
+        wait until falling_edge(clk);
+        read_reg(PATTERN_SELECT_ADDR, data);
+        assert data = x"00000005"
+            report "Pattern_select did not select CUSTOM"
+            severity error;
+
+        -- Write FIFO: queue four entries in one burst, with a watermark of
+        -- one, while software controls the LEDs
+        write_reg(0, 1);
+        write_reg(IRQ_STATUS_ADDR, 16#F#);
+        write_reg(IRQ_MASK_ADDR, 16#8#);
+        write_reg(FIFO_WATERMARK_ADDR, 1);
+        entries := (x"00000011", 32x"10", x"00000022", 32x"20",
+                    x"00000033", 32x"5",  x"00000044", 32x"7");
+        avalon_write_burst(clk, m2s, s2m, FIFO_ADDR, entries);
+        read_reg(FIFO_LEVEL_ADDR, data);
+        assert data = x"00000004"
+            report "Write FIFO level did not count pushed entries"
+            severity error;
+        assert irq = '0'
+            report "Filling the write FIFO raised irq"
+            severity error;
+
+        -- Once running, each entry shows for exactly its hold time
+        write_reg(FIFO_CONTROL_ADDR, 1);
+        wait_for_led(x"11", cycles);
+        assert cycles < 5
+            report "Write FIFO did not show its first entry"
+            severity error;
+        wait_for_led(x"22", cycles);
+        assert cycles = 16#10#
+            report "First write FIFO entry held for " & integer'image(cycles) & " cycles"
+            severity error;
+        wait_for_led(x"33", cycles);
+        assert cycles = 16#20#
+            report "Second write FIFO entry held for " & integer'image(cycles) & " cycles"
+            severity error;
+        wait_for_led(x"44", cycles);
+        assert cycles = 5
+            report "Third write FIFO entry held for " & integer'image(cycles) & " cycles"
+            severity error;
+        -- Popping the third entry left one queued, reaching the watermark
+        assert irq = '1'
+            report "Write FIFO low watermark did not raise irq"
+            severity error;
+        write_reg(IRQ_STATUS_ADDR, 16#8#);
+
+        -- Running dry keeps the last entry, and flags an underflow
+        wait_cycles(10);
+        assert LED = x"44"
+            report "Write FIFO underflow changed the LEDs"
+            severity error;
+        read_reg(FIFO_STATUS_ADDR, data);
+        assert data(4 downto 0) = "01011"
+            report "Write FIFO underflow not flagged"
+            severity error;
+        write_reg(FIFO_STATUS_ADDR, 16#18#);
+        read_reg(FIFO_STATUS_ADDR, data);
+        assert data(3) = '0'
+            report "Write FIFO underflow did not clear"
+            severity error;
+
+        -- After an underflow, a new entry shows as soon as it arrives
+        write_reg(FIFO_ADDR, 16#55#);
+        write_reg(FIFO_ADDR + 1, 100);
+        wait_for_led(x"55", cycles);
+        assert cycles < 5
+            report "Write FIFO did not resume after an underflow"
+            severity error;
+
+        -- Stopped, the FIFO fills up, drops further entries, and flushes
+        write_reg(FIFO_CONTROL_ADDR, 0);
+        read_reg(FIFO_DEPTH_ADDR, data);
+        depth := to_integer(unsigned(data));
+        for i in 0 to depth loop
+            write_reg(FIFO_ADDR, i mod 256);
+            write_reg(FIFO_ADDR + 1, 1);
+        end loop;
+        read_reg(FIFO_LEVEL_ADDR, data);
+        assert to_integer(unsigned(data)) = depth
+            report "Write FIFO level wrong when full"
+            severity error;
+        read_reg(FIFO_STATUS_ADDR, data);
+        assert data(4 downto 0) = "10100"
+            report "Write FIFO overflow not flagged"
+            severity error;
+        write_reg(FIFO_CONTROL_ADDR, 2);
+        read_reg(FIFO_LEVEL_ADDR, data);
+        assert data = x"00000000"
+            report "Write FIFO did not flush"
+            severity error;
+
+        -- PWM brightness: with every LED on, dim LEDs 0 to 3 through a
+        -- custom gamma table entry, zero, full, and the default curve
+        -- (brightness 0x40 maps to 12), leaving the rest at full brightness
+        write_reg(LED_REG_ADDR, 16#FF#);
+        write_reg(GAMMA_ADDR + 16#80#, 100);
+        write_reg(BRIGHTNESS_ADDR, 16#40FF0080#);
+        -- Let the new duty cycles reach every LED, and a period start
+        wait_cycles(2 * PWM_CYCLES);
+        measure_duty(lit);
+        assert lit = (100, 0, 255, 12, 255, 255, 255, 255)
+            report "PWM duty cycles " & integer'image(lit(0)) & ", " & integer'image(lit(1)) &
+                   ", " & integer'image(lit(2)) & ", " & integer'image(lit(3)) & ", " & integer'image(lit(4))
+            severity error;
+
+        -- Changing the gamma table alone changes the duty cycle
+        write_reg(GAMMA_ADDR + 16#80#, 200);
+        wait_cycles(PWM_CYCLES);
+        measure_duty(lit);
+        assert lit(0) = 200
+            report "Gamma table change gave duty cycle " & integer'image(lit(0))
+            severity error;
+
+        -- Brightness dims LEDs that are on, but doesn't light those that are off
+        write_reg(LED_REG_ADDR, 16#FE#);
+        wait until falling_edge(clk);
+        measure_duty(lit);
+        assert lit(0) = 0 and lit(3) = 12
+            report "PWM lit an LED that was off"
+            severity error;
+        avalon_write(clk, m2s, s2m, BRIGHTNESS_ADDR, x"FFFFFFFF");
+        write_reg(0, 0);
+
+        finish;
+    end process;
+
+end architecture;
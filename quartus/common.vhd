@@ -20,4 +20,41 @@ package common is
     type slv_2d is array(integer range <>) of std_logic_vector;
     type byte_2d is array(integer range <>) of std_logic_vector(7 downto 0);
 
+    -- Pattern table geometry: 2**PATTERN_TABLE_BITS entries, each holding an
+    -- LED value and a duration (in Base_rate ticks)
+    constant PATTERN_TABLE_BITS    : natural := 7;
+    constant PATTERN_DURATION_BITS : natural := 16;
+
+    -- Write FIFO depth: 2**WRITE_FIFO_BITS entries, each holding an LED value
+    -- and a hold time (in clock cycles)
+    constant WRITE_FIFO_BITS : natural := 8;
+
+    -- Largest supported LED count: LED_reg is mapped as up to 128 words
+    constant LED_WIDTH_MAX : positive := 128 * 32;
+
+    -- Width of the LED values held in the pattern table, which covers at most
+    -- the first 32 LEDs (one word per entry)
+    function table_led_width (led_width : positive) return positive;
+
+    -- Interrupt sources, as bit positions in the IRQ status and mask registers
+    constant IRQ_PB      : natural := 0;
+    constant IRQ_SW      : natural := 1;
+    constant IRQ_PATTERN : natural := 2;
+    constant IRQ_FIFO    : natural := 3;
+    constant IRQ_BITS    : natural := 4;
+
 end package;
+
+
+package body common is
+
+    function table_led_width (led_width : positive) return positive is
+    begin
+        if led_width > 32 then
+            return 32;
+        else
+            return led_width;
+        end if;
+    end function;
+
+end package body;
@@ -47,6 +47,20 @@ add_fileset_file hps_led_patterns.vhd VHDL PATH hps_led_patterns.vhd TOP_LEVEL_F
 # 
 # parameters
 # 
+add_parameter SYS_CLK_FREQ NATURAL 50000000
+set_parameter_property SYS_CLK_FREQ DEFAULT_VALUE 50000000
+set_parameter_property SYS_CLK_FREQ DISPLAY_NAME SYS_CLK_FREQ
+set_parameter_property SYS_CLK_FREQ TYPE NATURAL
+set_parameter_property SYS_CLK_FREQ UNITS None
+set_parameter_property SYS_CLK_FREQ ALLOWED_RANGES 0:2147483647
+set_parameter_property SYS_CLK_FREQ HDL_PARAMETER true
+add_parameter LED_WIDTH POSITIVE 8
+set_parameter_property LED_WIDTH DEFAULT_VALUE 8
+set_parameter_property LED_WIDTH DISPLAY_NAME LED_WIDTH
+set_parameter_property LED_WIDTH TYPE POSITIVE
+set_parameter_property LED_WIDTH UNITS None
+set_parameter_property LED_WIDTH ALLOWED_RANGES 3:4096
+set_parameter_property LED_WIDTH HDL_PARAMETER true
 
 
 # 
@@ -96,10 +110,10 @@ set_interface_property s1 burstcountUnits WORDS
 set_interface_property s1 explicitAddressSpan 0
 set_interface_property s1 holdTime 0
 set_interface_property s1 linewrapBursts false
-set_interface_property s1 maximumPendingReadTransactions 0
+set_interface_property s1 maximumPendingReadTransactions 2
 set_interface_property s1 maximumPendingWriteTransactions 0
 set_interface_property s1 readLatency 0
-set_interface_property s1 readWaitTime 1
+set_interface_property s1 readWaitTime 0
 set_interface_property s1 setupTime 0
 set_interface_property s1 timingUnits Cycles
 set_interface_property s1 writeWaitTime 0
@@ -111,15 +125,37 @@ set_interface_property s1 SVD_ADDRESS_GROUP ""
 
 add_interface_port s1 avs_s1_read read Input 1
 add_interface_port s1 avs_s1_write write Input 1
-add_interface_port s1 avs_s1_address address Input 2
+add_interface_port s1 avs_s1_address address Input 10
 add_interface_port s1 avs_s1_readdata readdata Output 32
 add_interface_port s1 avs_s1_writedata writedata Input 32
+add_interface_port s1 avs_s1_burstcount burstcount Input 5
+add_interface_port s1 avs_s1_byteenable byteenable Input 4
+add_interface_port s1 avs_s1_waitrequest waitrequest Output 1
+add_interface_port s1 avs_s1_readdatavalid readdatavalid Output 1
 set_interface_assignment s1 embeddedsw.configuration.isFlash 0
 set_interface_assignment s1 embeddedsw.configuration.isMemoryDevice 0
 set_interface_assignment s1 embeddedsw.configuration.isNonVolatileStorage 0
 set_interface_assignment s1 embeddedsw.configuration.isPrintableDevice 0
 
 
+# 
+# connection point irq
+# 
+add_interface irq interrupt end
+set_interface_property irq associatedAddressablePoint s1
+set_interface_property irq associatedClock clock
+set_interface_property irq associatedReset reset
+set_interface_property irq bridgedReceiverOffset ""
+set_interface_property irq bridgesToReceiver ""
+set_interface_property irq ENABLED true
+set_interface_property irq EXPORT_OF ""
+set_interface_property irq PORT_NAME_MAP ""
+set_interface_property irq CMSIS_SVD_VARIABLES ""
+set_interface_property irq SVD_ADDRESS_GROUP ""
+
+add_interface_port irq irq irq Output 1
+
+
 # 
 # connection point export
 # 
@@ -134,5 +170,5 @@ set_interface_property export SVD_ADDRESS_GROUP ""
 
 add_interface_port export PB pushbutton Input 1
 add_interface_port export SW switches Input 4
-add_interface_port export LED leds Output 8
+add_interface_port export LED leds Output LED_WIDTH
 
@@ -9,26 +9,49 @@ library ieee;
 use ieee.std_logic_1164.all;
 use ieee.numeric_std.all;
 use ieee.std_logic_unsigned.all;
+use ieee.math_real.all;
 
 
 -- HPS interface for LED Patterns module
 entity HPS_LED_Patterns is
+    generic (
+        -- Number of system clock cycles per second
+        SYS_CLK_FREQ : natural := 50000000;
+        -- Number of LEDs
+        LED_WIDTH    : positive range 3 to LED_WIDTH_MAX := 8
+    );
     port (
         clk              : in    std_logic;
         -- NOTE: Active high reset
         reset            : in    std_logic;
-        -- Memory-mapped Avalon agent interface
-        avs_s1_read      : in    std_logic;
-        avs_s1_write     : in    std_logic;
-        avs_s1_address   : in    std_logic_vector(1 downto 0);
-        avs_s1_readdata  : out   std_logic_vector(31 downto 0);
-        avs_s1_writedata : in    std_logic_vector(31 downto 0);
+        -- Memory-mapped Avalon agent interface, with pipelined reads (one
+        -- cycle of latency) and bursts of up to 16 words
+        -- NOTE: Word addresses 0x080 and up map LED_reg, 32 LEDs per word
+        -- (word 1 aliases the first of them); 0x040 to 0x06D map per-register
+        -- write timestamps; 0x070 to 0x07F push write FIFO entries, as an LED
+        -- value at even addresses followed by a hold time at odd ones (which
+        -- pushes the pair); 0x100 to 0x1FF map the pattern
+        -- table, where entry N holds its LED value at 0x100 + 2N and duration
+        -- at 0x101 + 2N; 0x200 to 0x2FF map LED brightness, one byte per LED
+        -- and four LEDs per word; 0x300 to 0x3FF map the gamma table, one
+        -- entry per word
+        avs_s1_read          : in    std_logic;
+        avs_s1_write         : in    std_logic;
+        avs_s1_address       : in    std_logic_vector(9 downto 0);
+        avs_s1_burstcount    : in    std_logic_vector(4 downto 0);
+        avs_s1_byteenable    : in    std_logic_vector(3 downto 0);
+        avs_s1_waitrequest   : out   std_logic;
+        avs_s1_readdata      : out   std_logic_vector(31 downto 0);
+        avs_s1_readdatavalid : out   std_logic;
+        avs_s1_writedata     : in    std_logic_vector(31 downto 0);
+        -- Interrupt sender (active high, held until acknowledged)
+        irq                  : out   std_logic;
         -- Active high state-change signal
-        PB               : in    std_logic;
+        PB                   : in    std_logic;
         -- Next-state selection switches
-        SW               : in    std_logic_vector(3 downto 0);
+        SW                   : in    std_logic_vector(3 downto 0);
         -- LED outputs
-        LED              : out   std_logic_vector(7 downto 0)
+        LED                  : out   std_logic_vector(LED_WIDTH - 1 downto 0)
     );
 end entity;
 
@@ -36,19 +59,223 @@ end entity;
 architecture HPS_LED_Patterns_Arch of HPS_LED_Patterns is
 
     -- Number of system clock cycles per second
-    constant SYS_CLKs_sec : unsigned := to_unsigned(50000000, 26);
+    constant SYS_CLKs_sec : unsigned := to_unsigned(SYS_CLK_FREQ, 26);
+
+    -- LED_reg layout: LED_WORDS words, mapped from LED_WINDOW_ADDR up
+    constant LED_WORDS       : positive := (LED_WIDTH + 31) / 32;
+    constant LED_WINDOW_ADDR : natural  := 16#080#;
+    constant LED_REG_RESET   : std_logic_vector(LED_WIDTH - 1 downto 0) :=
+        std_logic_vector(resize(unsigned'(x"55"), LED_WIDTH));
+    -- Pattern table LED values cover the first (up to) 32 LEDs
+    constant TABLE_LED_WIDTH : positive := table_led_width(LED_WIDTH);
+
+    -- Read-only capability register, so software can size itself: the LED
+    -- count in bits 15:0, and log2 of the pattern table entry count in bits
+    -- 23:16; bits 31:24 are feature flags (bit 24: cycle counter and write
+    -- timestamps; bit 25: write FIFO; bit 26: pattern select; bit 27:
+    -- Base_period; bit 28: PWM brightness)
+    constant CAPABILITIES : std_logic_vector(31 downto 0) :=
+        x"1F" & std_logic_vector(to_unsigned(PATTERN_TABLE_BITS, 8)) &
+        std_logic_vector(to_unsigned(LED_WIDTH, 16));
+
+    -- Write timestamps: one 64-bit slot per control register word (0 to
+    -- STAMP_SLOTS - 1), mapped from STAMP_WINDOW_ADDR up as low/high pairs
+    constant STAMP_SLOTS       : positive := 23;
+    constant STAMP_WINDOW_ADDR : natural  := 16#040#;
+
+    -- Write FIFO geometry
+    constant FIFO_DEPTH : positive := 2 ** WRITE_FIFO_BITS;
+
+    -- PWM brightness: the first PWM_WIDTH LEDs (as many as the window holds)
+    -- each have a brightness byte, mapped four per word from
+    -- BRIGHTNESS_WINDOW_ADDR up; any LEDs beyond them are never dimmed
+    constant PWM_WIDTH              : positive := minimum(LED_WIDTH, 1024);
+    constant PWM_WORDS              : positive := (PWM_WIDTH + 3) / 4;
+    constant BRIGHTNESS_WINDOW_ADDR : natural  := 16#200#;
+    -- Each PWM period is 255 steps, so a duty cycle of 255 is always on;
+    -- steps are PWM_STEP_CYCLES long, for a period of about 1 ms
+    constant PWM_STEPS       : positive := 255;
+    constant PWM_STEP_CYCLES : positive := maximum(1, SYS_CLK_FREQ / (PWM_STEPS * 1000));
+
+    -- Gamma table maps each brightness to its duty cycle, initially with an
+    -- exponent of 2.2, so equal brightness steps look roughly equal
+    type gamma_table_t is array(0 to 255) of unsigned(7 downto 0);
+    function gamma_curve (gamma : real) return gamma_table_t is
+        variable table : gamma_table_t;
+    begin
+        for i in table'range loop
+            table(i) := to_unsigned(integer(round(255.0 * (real(i) / 255.0) ** gamma)), 8);
+        end loop;
+        return table;
+    end function;
+
+    -- Index of the LED_reg word mapped at a word address, or -1 if none is
+    function led_word (addr : unsigned) return integer is
+    begin
+        if addr = 1 then
+            return 0;
+        elsif addr >= LED_WINDOW_ADDR and addr < LED_WINDOW_ADDR + LED_WORDS then
+            return to_integer(addr) - LED_WINDOW_ADDR;
+        else
+            return -1;
+        end if;
+    end function;
+
+    -- A register's value after a write: bits in the byte lanes written take
+    -- the write data, and the rest keep their old value
+    function merge_lanes (old : unsigned; data : std_logic_vector(31 downto 0);
+                          lanes : std_logic_vector(3 downto 0)) return unsigned is
+        variable merged : unsigned(old'length - 1 downto 0) := old;
+    begin
+        for i in merged'range loop
+            if lanes(i / 8) = '1' then
+                merged(i) := data(i);
+            end if;
+        end loop;
+        return merged;
+    end function;
 
     -- Avalon-mapped LED control registers
     signal HPS_LED_control : std_logic                    := '0';
-    signal LED_reg         : std_logic_vector(7 downto 0) := "01010101";
+    signal LED_reg         : std_logic_vector(LED_WIDTH - 1 downto 0) := LED_REG_RESET;
     signal Base_rate       : unsigned(7 downto 0)         := x"10";
+    -- Base transition period in cycles, used instead of Base_rate unless
+    -- zero; writing Base_rate clears it
+    signal Base_period     : unsigned(31 downto 0)        := (others => '0');
+
+    -- Avalon-mapped pattern player registers
+    signal Player_start  : std_logic := '0';
+    signal Player_stop   : std_logic := '0';
+    signal Player_loop   : std_logic := '1';
+    signal Player_first  : unsigned(PATTERN_TABLE_BITS - 1 downto 0) := (others => '0');
+    signal Player_length : unsigned(PATTERN_TABLE_BITS downto 0)     := (others => '0');
+    signal Player_busy   : std_logic;
+    signal Player_index  : unsigned(PATTERN_TABLE_BITS - 1 downto 0);
+
+    -- Pattern table block RAM, with an Avalon port (A) and a player port (B)
+    type   led_table_t is array(0 to 2 ** PATTERN_TABLE_BITS - 1) of std_logic_vector(TABLE_LED_WIDTH - 1 downto 0);
+    type   duration_table_t is array(0 to 2 ** PATTERN_TABLE_BITS - 1) of unsigned(PATTERN_DURATION_BITS - 1 downto 0);
+    signal led_table        : led_table_t;
+    signal duration_table   : duration_table_t;
+    signal table_led_a      : std_logic_vector(TABLE_LED_WIDTH - 1 downto 0);
+    signal table_duration_a : unsigned(PATTERN_DURATION_BITS - 1 downto 0);
+    signal table_index_b    : unsigned(PATTERN_TABLE_BITS - 1 downto 0);
+    signal table_led_b      : std_logic_vector(TABLE_LED_WIDTH - 1 downto 0);
+    signal table_duration_b : unsigned(PATTERN_DURATION_BITS - 1 downto 0);
+
+    -- Avalon-mapped interrupt registers
+    -- IRQ_status bits latch events until written back as ones, and any bit
+    -- also set in IRQ_mask raises irq
+    signal IRQ_status : std_logic_vector(IRQ_BITS - 1 downto 0) := (others => '0');
+    signal IRQ_mask   : std_logic_vector(IRQ_BITS - 1 downto 0) := (others => '0');
+    -- Single-cycle strobes from Avalon writes, to acknowledge or raise events
+    signal IRQ_clear  : std_logic_vector(IRQ_BITS - 1 downto 0) := (others => '0');
+    signal IRQ_raise  : std_logic_vector(IRQ_BITS - 1 downto 0) := (others => '0');
+
+    -- Avalon-mapped write FIFO registers
+    -- Entries of {LED value, hold cycles} are drained into LED_reg while
+    -- FIFO_run is set, each showing for exactly its hold time
+    signal FIFO_run       : std_logic := '0';
+    signal FIFO_watermark : unsigned(WRITE_FIFO_BITS downto 0) := to_unsigned(FIFO_DEPTH / 4, WRITE_FIFO_BITS + 1);
+    signal FIFO_underflow : std_logic := '0';
+    signal FIFO_overflow  : std_logic := '0';
+    -- LED value staged by an even push window write, until its hold time
+    -- arrives
+    signal FIFO_stage     : std_logic_vector(31 downto 0) := (others => '0');
+    -- Single-cycle strobes from Avalon writes, to flush the FIFO or clear its
+    -- sticky (underflow, overflow) flags
+    signal FIFO_flush     : std_logic := '0';
+    signal FIFO_clear     : std_logic_vector(1 downto 0) := (others => '0');
+
+    -- Write FIFO block RAM, holding each entry's LED value (63:32) and hold
+    -- time (31:0), and its pointers (with an extra bit, to tell full from
+    -- empty). fifo_wr_seen lags fifo_wr_ptr by a cycle, covering the RAM's
+    -- read latency, so the head entry is only valid once it can be read.
+    type   fifo_ram_t is array(0 to FIFO_DEPTH - 1) of std_logic_vector(63 downto 0);
+    signal fifo_ram        : fifo_ram_t;
+    signal fifo_head       : std_logic_vector(63 downto 0);
+    signal fifo_wr_ptr     : unsigned(WRITE_FIFO_BITS downto 0);
+    signal fifo_wr_seen    : unsigned(WRITE_FIFO_BITS downto 0);
+    signal fifo_rd_ptr     : unsigned(WRITE_FIFO_BITS downto 0);
+    signal fifo_rd_addr    : unsigned(WRITE_FIFO_BITS - 1 downto 0);
+    signal fifo_level      : unsigned(WRITE_FIFO_BITS downto 0);
+    signal fifo_hold_left  : unsigned(31 downto 0);
+    signal fifo_window     : std_logic;
+    signal fifo_push       : std_logic;
+    signal fifo_pop        : std_logic;
+    signal fifo_full       : std_logic;
+    signal fifo_empty      : std_logic;
+    signal fifo_low        : std_logic;
+    signal fifo_head_valid : std_logic;
+    -- Asserted once an entry has been shown, until the FIFO runs dry
+    signal fifo_playing    : std_logic;
+
+    -- Avalon-mapped built-in pattern selection, and its load strobe
+    signal Pattern_select : unsigned(2 downto 0) := (others => '0');
+    signal Pattern_load   : std_logic            := '0';
+
+    -- Avalon-mapped PWM brightness, one byte per LED (all full after reset)
+    signal Brightness : byte_2d(0 to PWM_WIDTH - 1) := (others => x"FF");
+
+    -- Gamma table block RAM, with an Avalon port (A) and a port (B) through
+    -- which each LED's brightness is looked up in turn
+    signal gamma_table   : gamma_table_t := gamma_curve(2.2);
+    signal gamma_a       : unsigned(7 downto 0);
+    signal gamma_b       : unsigned(7 downto 0);
+    -- LED whose brightness is being looked up, and the one whose duty cycle
+    -- is arriving from port B
+    signal pwm_scan      : natural range 0 to PWM_WIDTH - 1;
+    signal pwm_scan_last : natural range 0 to PWM_WIDTH - 1;
+    -- Duty cycle of each LED, in PWM steps out of PWM_STEPS
+    signal pwm_duty      : byte_2d(0 to PWM_WIDTH - 1);
+    -- PWM step counter and its prescaler, and the resulting mask of LEDs
+    -- currently allowed on
+    signal pwm_step      : natural range 0 to PWM_STEPS - 1;
+    signal pwm_prescale  : natural range 0 to PWM_STEP_CYCLES - 1;
+    signal pwm_mask      : std_logic_vector(LED_WIDTH - 1 downto 0);
+    -- LED outputs from LED_Patterns, before dimming
+    signal LED_on        : std_logic_vector(LED_WIDTH - 1 downto 0);
+
+    -- Event sources: synchronized switches and the selected pattern, along
+    -- with their values as of the previous cycle
+    signal SW_meta, SW_sync, SW_last : std_logic_vector(3 downto 0);
+    signal Pattern, Pattern_last     : unsigned(2 downto 0);
+    signal fifo_low_last             : std_logic;
+
+    -- Free-running cycle counter, and the write timestamps taken from it
+    -- Reading any low word (Counter_lo or a timestamp) latches the matching
+    -- high word into hi_latch, so a low-then-high read pair is consistent.
+    type   stamp_array_t is array(0 to STAMP_SLOTS - 1) of unsigned(63 downto 0);
+    signal cycle_count  : unsigned(63 downto 0) := (others => '0');
+    signal write_stamps : stamp_array_t         := (others => (others => '0'));
+    signal hi_latch     : unsigned(31 downto 0) := (others => '0');
+
+    -- Avalon burst tracking: beats remaining after the current one, and the
+    -- word address of the next beat
+    signal read_left,  write_left : unsigned(avs_s1_burstcount'range);
+    signal read_next,  write_next : unsigned(avs_s1_address'range);
+    -- Word address of the read/write beat being handled in this cycle
+    signal read_addr,  write_addr : unsigned(avs_s1_address'range);
+    signal read_beat,  write_beat : std_logic;
+    signal waitrequest            : std_logic;
+    -- Pattern table port A address (shared by reads and writes)
+    signal table_entry_a          : natural range 0 to 2 ** PATTERN_TABLE_BITS - 1;
+
+    -- Registered read results, muxed onto avs_s1_readdata
+    signal register_readdata : std_logic_vector(31 downto 0);
+    signal read_table        : std_logic;
+    signal read_duration     : std_logic;
+    signal read_gamma        : std_logic;
 
     -- LED_Patterns component
     -- Using this instead of direct instantiation makes Platform Designer happier
     component LED_Patterns is
         generic (
             -- Number of system clock cycles per second
-            SYS_CLKs_sec : unsigned
+            SYS_CLKs_sec : unsigned;
+            -- Number of LEDs; the top one is the heartbeat, and the built-in
+            -- patterns use the rest
+            LED_WIDTH    : positive range 3 to LED_WIDTH_MAX := 8
         );
         port (
             clk             : in    std_logic;
@@ -62,52 +289,541 @@ architecture HPS_LED_Patterns_Arch of HPS_LED_Patterns is
             HPS_LED_control : in    std_logic;
             -- Base transition period, in seconds (UQ4.4)
             Base_rate       : in    unsigned(7 downto 0);
+            -- Base transition period, in system clock cycles, used instead of
+            -- Base_rate unless zero
+            Base_period     : in    unsigned(31 downto 0);
             -- LED register
-            LED_reg         : in    std_logic_vector(7 downto 0);
+            LED_reg         : in    std_logic_vector(LED_WIDTH - 1 downto 0);
+            -- Pattern player start/stop strobes (single-cycle, active high)
+            Player_start    : in    std_logic;
+            Player_stop     : in    std_logic;
+            -- Asserted to restart from Player_first after the last entry
+            Player_loop     : in    std_logic;
+            -- First pattern table entry to play, and number of entries to play
+            Player_first    : in    unsigned(PATTERN_TABLE_BITS - 1 downto 0);
+            Player_length   : in    unsigned(PATTERN_TABLE_BITS downto 0);
+            -- Asserted while the pattern player drives the LEDs
+            Player_busy     : out   std_logic;
+            -- Pattern table entry currently displayed by the player
+            Player_index    : out   unsigned(PATTERN_TABLE_BITS - 1 downto 0);
+            -- Pattern table read port (one cycle of read latency)
+            Table_index     : out   unsigned(PATTERN_TABLE_BITS - 1 downto 0);
+            Table_LED       : in    std_logic_vector(table_led_width(LED_WIDTH) - 1 downto 0);
+            Table_duration  : in    unsigned(PATTERN_DURATION_BITS - 1 downto 0);
+            -- Built-in pattern to select in software, numbered as for Pattern,
+            -- and its load strobe (single-cycle, active high); selecting 0 acts
+            -- like a press of PB
+            Pattern_select  : in    unsigned(2 downto 0);
+            Pattern_load    : in    std_logic;
+            -- Built-in pattern currently selected (0 while showing the switches)
+            Pattern         : out   unsigned(2 downto 0);
             -- LED outputs
-            LED             : out   std_logic_vector(7 downto 0)
+            LED             : out   std_logic_vector(LED_WIDTH - 1 downto 0)
         );
     end component;
 
 begin
 
+    -- Avalon burst tracking
+    -- Read bursts return one beat per cycle, and hold off further commands
+    -- (via waitrequest) until the last beat has been issued; write bursts are
+    -- accepted at full rate, so never need to wait
+    waitrequest <= '1' when read_left /= 0 else '0';
+    avs_s1_waitrequest <= waitrequest;
+    read_beat  <= '1' when read_left /= 0 or avs_s1_read = '1' else '0';
+    read_addr  <= read_next when read_left /= 0 else unsigned(avs_s1_address);
+    write_beat <= avs_s1_write and not waitrequest;
+    write_addr <= write_next when write_left /= 0 else unsigned(avs_s1_address);
+
+    avalon_bursts : process (clk, reset) is
+    begin
+        if reset then
+            read_left  <= (others => '0');
+            write_left <= (others => '0');
+            read_next  <= (others => '0');
+            write_next <= (others => '0');
+        elsif rising_edge(clk) then
+            if read_left /= 0 then
+                read_left <= read_left - 1;
+                read_next <= read_next + 1;
+            elsif avs_s1_read = '1' then
+                -- Treat a (nonsensical) burstcount of zero as one
+                if unsigned(avs_s1_burstcount) > 1 then
+                    read_left <= unsigned(avs_s1_burstcount) - 1;
+                end if;
+                read_next <= unsigned(avs_s1_address) + 1;
+            end if;
+            if write_beat = '1' then
+                if write_left /= 0 then
+                    write_left <= write_left - 1;
+                elsif unsigned(avs_s1_burstcount) > 1 then
+                    write_left <= unsigned(avs_s1_burstcount) - 1;
+                end if;
+                write_next <= write_addr + 1;
+            end if;
+        end if;
+    end process;
+
     -- Manage reading from mapped registers
-    avalon_register_read : process (clk) is
-    begin
-        if rising_edge(clk) and avs_s1_read = '1' then
-            case avs_s1_address is
-                when "00"   => avs_s1_readdata <= 31x"0" & HPS_LED_control;
-                when "01"   => avs_s1_readdata <= 24x"0" & LED_reg;
-                when "10"   => avs_s1_readdata <= 24x"0" & std_logic_vector(Base_rate);
-                -- Return zeros for unused registers
-                when others => avs_s1_readdata <= (others => '0');
-            end case;
+    avalon_register_read : process (clk, reset) is
+        variable led_padded : std_logic_vector(32 * LED_WORDS - 1 downto 0);
+        variable word       : integer;
+        variable stamp      : unsigned(63 downto 0);
+        variable pwm_word   : natural;
+    begin
+        if reset then
+            avs_s1_readdatavalid <= '0';
+            hi_latch             <= (others => '0');
+        elsif rising_edge(clk) then
+            avs_s1_readdatavalid <= read_beat;
+            if read_beat then
+                if read_addr(9 downto 8) = "01" then
+                    read_table <= '1';
+                else
+                    read_table <= '0';
+                end if;
+                if read_addr(9 downto 8) = "11" then
+                    read_gamma <= '1';
+                else
+                    read_gamma <= '0';
+                end if;
+                read_duration <= read_addr(0);
+                led_padded    := std_logic_vector(resize(unsigned(LED_reg), led_padded'length));
+                word          := led_word(read_addr);
+                case to_integer(read_addr) is
+                    when 0      => register_readdata <= 31x"0" & HPS_LED_control;
+                    when 2      => register_readdata <= 24x"0" & std_logic_vector(Base_rate);
+                    when 3      => register_readdata <= 31x"0" & Player_busy;
+                    when 4      => register_readdata <= 31x"0" & Player_loop;
+                    when 5      => register_readdata <= std_logic_vector(resize(Player_first, 32));
+                    when 6      => register_readdata <= std_logic_vector(resize(Player_length, 32));
+                    when 7      => register_readdata <= std_logic_vector(resize(Player_index, 32));
+                    when 8      => register_readdata <= std_logic_vector(resize(unsigned(IRQ_status), 32));
+                    when 9      => register_readdata <= std_logic_vector(resize(unsigned(IRQ_mask), 32));
+                    when 11     => register_readdata <= 25x"0" & std_logic_vector(Pattern) & SW_sync;
+                    when 12     => register_readdata <= CAPABILITIES;
+                    when 13     =>
+                        register_readdata <= std_logic_vector(cycle_count(31 downto 0));
+                        hi_latch          <= cycle_count(63 downto 32);
+                    when 14     => register_readdata <= std_logic_vector(hi_latch);
+                    when 15     => register_readdata <= std_logic_vector(to_unsigned(SYS_CLK_FREQ, 32));
+                    when 16     => register_readdata <= 31x"0" & FIFO_run;
+                    when 17     => register_readdata <= std_logic_vector(resize(fifo_level, 32));
+                    when 18     => register_readdata <= 27x"0" & FIFO_overflow & FIFO_underflow & fifo_full & fifo_low & fifo_empty;
+                    when 19     => register_readdata <= std_logic_vector(resize(FIFO_watermark, 32));
+                    when 20     => register_readdata <= std_logic_vector(to_unsigned(FIFO_DEPTH, 32));
+                    when 21     => register_readdata <= 29x"0" & std_logic_vector(Pattern);
+                    when 22     => register_readdata <= std_logic_vector(Base_period);
+                    -- Return zeros for unused registers
+                    when others => register_readdata <= (others => '0');
+                end case;
+                if word >= 0 then
+                    register_readdata <= led_padded(32 * word + 31 downto 32 * word);
+                end if;
+                if read_addr >= STAMP_WINDOW_ADDR and read_addr < STAMP_WINDOW_ADDR + 2 * STAMP_SLOTS then
+                    stamp := write_stamps(to_integer(read_addr - STAMP_WINDOW_ADDR) / 2);
+                    if read_addr(0) = '0' then
+                        register_readdata <= std_logic_vector(stamp(31 downto 0));
+                        hi_latch          <= stamp(63 downto 32);
+                    else
+                        register_readdata <= std_logic_vector(hi_latch);
+                    end if;
+                end if;
+                if read_addr >= BRIGHTNESS_WINDOW_ADDR and read_addr < BRIGHTNESS_WINDOW_ADDR + PWM_WORDS then
+                    pwm_word := to_integer(read_addr) - BRIGHTNESS_WINDOW_ADDR;
+                    for lane in 0 to 3 loop
+                        if 4 * pwm_word + lane < PWM_WIDTH then
+                            register_readdata(8 * lane + 7 downto 8 * lane) <= Brightness(4 * pwm_word + lane);
+                        else
+                            register_readdata(8 * lane + 7 downto 8 * lane) <= (others => '0');
+                        end if;
+                    end loop;
+                end if;
+            end if;
         end if;
     end process;
 
+    -- Select between register, pattern table and gamma table reads
+    avs_s1_readdata <= std_logic_vector(resize(gamma_a, 32)) when read_gamma = '1' else
+                       register_readdata when read_table = '0' else
+                       std_logic_vector(resize(unsigned(table_led_a), 32)) when read_duration = '0' else
+                       std_logic_vector(resize(table_duration_a, 32));
+
     -- Manage writing to mapped registers
+    -- NOTE: Byte lanes not selected by avs_s1_byteenable are left unchanged
     avalon_register_write : process (clk, reset) is
+        variable led_padded : std_logic_vector(32 * LED_WORDS - 1 downto 0);
+        variable word       : integer;
+        variable pwm_word   : natural;
     begin
         if reset then
             -- Reset all registers to their default values
             HPS_LED_control <= '0';
-            LED_reg         <= "01010101";
+            LED_reg         <= LED_REG_RESET;
             Base_rate       <= x"10";
-        elsif rising_edge(clk) and avs_s1_write = '1' then
-            case avs_s1_address is
-                when "00"   => HPS_LED_control <= avs_s1_writedata(0);
-                when "01"   => LED_reg <= avs_s1_writedata(7 downto 0);
-                when "10"   => Base_rate <= unsigned(avs_s1_writedata(7 downto 0));
-                -- Do nothing for unused registers
-                when others => null;
-            end case;
+            Base_period     <= (others => '0');
+            Player_start    <= '0';
+            Player_stop     <= '0';
+            Player_loop     <= '1';
+            Player_first    <= (others => '0');
+            Player_length   <= (others => '0');
+            IRQ_mask        <= (others => '0');
+            IRQ_clear       <= (others => '0');
+            IRQ_raise       <= (others => '0');
+            FIFO_run        <= '0';
+            FIFO_watermark  <= to_unsigned(FIFO_DEPTH / 4, FIFO_watermark'length);
+            FIFO_stage      <= (others => '0');
+            FIFO_flush      <= '0';
+            FIFO_clear      <= (others => '0');
+            Pattern_select  <= (others => '0');
+            Pattern_load    <= '0';
+            Brightness      <= (others => x"FF");
+            write_stamps    <= (others => (others => '0'));
+        elsif rising_edge(clk) then
+            -- Player control and interrupt acknowledge/raise bits are
+            -- single-cycle strobes
+            Player_start <= '0';
+            Player_stop  <= '0';
+            IRQ_clear    <= (others => '0');
+            IRQ_raise    <= (others => '0');
+            FIFO_flush   <= '0';
+            FIFO_clear   <= (others => '0');
+            Pattern_load <= '0';
+            -- The write FIFO updates the LEDs covered by its entries as each
+            -- one is popped; bus writes below take priority
+            if fifo_pop then
+                LED_reg(TABLE_LED_WIDTH - 1 downto 0) <= fifo_head(32 + TABLE_LED_WIDTH - 1 downto 32);
+            end if;
+            -- Stamp every write beat to a control register with the cycle
+            -- count at its clock edge; LED window writes stamp LED_reg (word 1)
+            word := led_word(write_addr);
+            if write_beat = '1' then
+                if write_addr < STAMP_SLOTS then
+                    write_stamps(to_integer(write_addr)) <= cycle_count;
+                elsif word >= 0 then
+                    write_stamps(1) <= cycle_count;
+                end if;
+            end if;
+            -- LED_reg words hold 32 LEDs each, and honour every byte lane
+            if write_beat = '1' and word >= 0 then
+                led_padded := std_logic_vector(resize(unsigned(LED_reg), led_padded'length));
+                for lane in 0 to 3 loop
+                    if avs_s1_byteenable(lane) then
+                        led_padded(32 * word + 8 * lane + 7 downto 32 * word + 8 * lane) :=
+                            avs_s1_writedata(8 * lane + 7 downto 8 * lane);
+                    end if;
+                end loop;
+                LED_reg <= led_padded(LED_WIDTH - 1 downto 0);
+            end if;
+            -- Brightness words hold four LEDs each, and honour every byte lane
+            if write_beat = '1' and write_addr >= BRIGHTNESS_WINDOW_ADDR and write_addr < BRIGHTNESS_WINDOW_ADDR + PWM_WORDS then
+                pwm_word := to_integer(write_addr) - BRIGHTNESS_WINDOW_ADDR;
+                for lane in 0 to 3 loop
+                    if avs_s1_byteenable(lane) = '1' and 4 * pwm_word + lane < PWM_WIDTH then
+                        Brightness(4 * pwm_word + lane) <= avs_s1_writedata(8 * lane + 7 downto 8 * lane);
+                    end if;
+                end loop;
+            end if;
+            -- Registers wider than a byte honour every byte lane too
+            if write_beat = '1' then
+                case to_integer(write_addr) is
+                    when 5      => Player_first <= merge_lanes(Player_first, avs_s1_writedata, avs_s1_byteenable);
+                    when 6      => Player_length <= merge_lanes(Player_length, avs_s1_writedata, avs_s1_byteenable);
+                    when 19     => FIFO_watermark <= merge_lanes(FIFO_watermark, avs_s1_writedata, avs_s1_byteenable);
+                    when 22     => Base_period <= merge_lanes(Base_period, avs_s1_writedata, avs_s1_byteenable);
+                    when others => null;
+                end case;
+                if fifo_window = '1' and write_addr(0) = '0' then
+                    FIFO_stage <= std_logic_vector(merge_lanes(unsigned(FIFO_stage), avs_s1_writedata, avs_s1_byteenable));
+                end if;
+            end if;
+            -- The rest fit in byte lane 0, and ignore writes that skip it
+            if write_beat = '1' and avs_s1_byteenable(0) = '1' then
+                case to_integer(write_addr) is
+                    when 0      => HPS_LED_control <= avs_s1_writedata(0);
+                    when 2      =>
+                        Base_rate   <= unsigned(avs_s1_writedata(7 downto 0));
+                        Base_period <= (others => '0');
+                    when 3      =>
+                        Player_start <= avs_s1_writedata(0);
+                        Player_stop  <= avs_s1_writedata(1);
+                    when 4      => Player_loop <= avs_s1_writedata(0);
+                    when 8      => IRQ_clear <= avs_s1_writedata(IRQ_BITS - 1 downto 0);
+                    when 9      => IRQ_mask <= avs_s1_writedata(IRQ_BITS - 1 downto 0);
+                    when 10     => IRQ_raise <= avs_s1_writedata(IRQ_BITS - 1 downto 0);
+                    when 16     =>
+                        FIFO_run   <= avs_s1_writedata(0);
+                        FIFO_flush <= avs_s1_writedata(1);
+                    when 18     => FIFO_clear <= avs_s1_writedata(4 downto 3);
+                    when 21     =>
+                        Pattern_select <= unsigned(avs_s1_writedata(2 downto 0));
+                        Pattern_load   <= '1';
+                    -- Do nothing for unused (or read-only) registers
+                    when others => null;
+                end case;
+            end if;
+        end if;
+    end process;
+
+    -- Write FIFO
+    -- An entry is pushed by each odd push window write, pairing its hold time
+    -- with the LED value staged before it; pushes to a full FIFO are dropped,
+    -- and flagged as an overflow. While running, the head entry is popped
+    -- into LED_reg as soon as the previous one's hold time expires, so
+    -- entries appear exactly their hold times apart. If the FIFO runs dry,
+    -- the last entry stays on the LEDs, an underflow is flagged, and the next
+    -- entry pushed is shown as soon as it arrives.
+    fifo_window     <= '1' when write_addr(9 downto 4) = "000111" else '0';
+    fifo_push       <= write_beat and avs_s1_byteenable(0) and fifo_window and write_addr(0);
+    fifo_level      <= fifo_wr_ptr - fifo_rd_ptr;
+    fifo_full       <= '1' when fifo_level = FIFO_DEPTH else '0';
+    fifo_empty      <= '1' when fifo_level = 0 else '0';
+    fifo_low        <= '1' when fifo_level <= FIFO_watermark else '0';
+    fifo_head_valid <= '1' when fifo_rd_ptr /= fifo_wr_seen else '0';
+    fifo_pop        <= '1' when FIFO_run = '1' and FIFO_flush = '0' and fifo_hold_left = 0 and fifo_head_valid = '1' else '0';
+    -- Read ahead to the next entry as the head is popped, so it is ready in
+    -- time for a hold of one cycle
+    fifo_rd_addr    <= fifo_rd_ptr(WRITE_FIFO_BITS - 1 downto 0) + 1 when fifo_pop = '1' else
+                       fifo_rd_ptr(WRITE_FIFO_BITS - 1 downto 0);
+
+    write_fifo : process (clk, reset) is
+    begin
+        if reset then
+            fifo_wr_ptr    <= (others => '0');
+            fifo_wr_seen   <= (others => '0');
+            fifo_rd_ptr    <= (others => '0');
+            fifo_hold_left <= (others => '0');
+            fifo_playing   <= '0';
+            FIFO_underflow <= '0';
+            FIFO_overflow  <= '0';
+        elsif rising_edge(clk) then
+            fifo_wr_seen <= fifo_wr_ptr;
+            -- New flags take priority over an acknowledgement in the same cycle
+            if FIFO_clear(0) then
+                FIFO_underflow <= '0';
+            end if;
+            if FIFO_clear(1) then
+                FIFO_overflow <= '0';
+            end if;
+
+            if fifo_push then
+                if fifo_full then
+                    FIFO_overflow <= '1';
+                else
+                    fifo_wr_ptr <= fifo_wr_ptr + 1;
+                end if;
+            end if;
+
+            if FIFO_flush then
+                fifo_rd_ptr    <= fifo_wr_ptr;
+                fifo_hold_left <= (others => '0');
+                fifo_playing   <= '0';
+            elsif not FIFO_run then
+                fifo_hold_left <= (others => '0');
+                fifo_playing   <= '0';
+            elsif fifo_hold_left /= 0 then
+                fifo_hold_left <= fifo_hold_left - 1;
+            elsif fifo_pop then
+                fifo_rd_ptr  <= fifo_rd_ptr + 1;
+                fifo_playing <= '1';
+                -- Treat a (nonsensical) hold time of zero as one
+                if unsigned(fifo_head(31 downto 0)) /= 0 then
+                    fifo_hold_left <= unsigned(fifo_head(31 downto 0)) - 1;
+                end if;
+            elsif fifo_playing then
+                FIFO_underflow <= '1';
+                fifo_playing   <= '0';
+            end if;
+        end if;
+    end process;
+
+    write_fifo_ram : process (clk) is
+    begin
+        if rising_edge(clk) then
+            if fifo_push = '1' and fifo_full = '0' then
+                fifo_ram(to_integer(fifo_wr_ptr(WRITE_FIFO_BITS - 1 downto 0))) <= FIFO_stage & avs_s1_writedata;
+            end if;
+            fifo_head <= fifo_ram(to_integer(fifo_rd_addr));
+        end if;
+    end process;
+
+    -- Free-running cycle counter, for timestamping and clock calibration
+    -- NOTE: At 50 MHz, 64 bits wrap after more than 11000 years
+    cycle_counter : process (clk, reset) is
+    begin
+        if reset then
+            cycle_count <= (others => '0');
+        elsif rising_edge(clk) then
+            cycle_count <= cycle_count + 1;
+        end if;
+    end process;
+
+    -- Interrupt event detection
+    -- PB is already a single-cycle pulse per debounced press; switch and
+    -- pattern changes are detected against their previous values, as is the
+    -- write FIFO's level falling to its low watermark. Events
+    -- (including those raised by software through IRQ_raise) take priority
+    -- over an acknowledgement in the same cycle, so none are lost.
+    interrupt_events : process (clk, reset) is
+        variable events : std_logic_vector(IRQ_BITS - 1 downto 0);
+    begin
+        if reset then
+            SW_meta       <= (others => '0');
+            SW_sync       <= (others => '0');
+            SW_last       <= (others => '0');
+            Pattern_last  <= (others => '0');
+            -- Start out low, so an empty FIFO doesn't raise an event
+            fifo_low_last <= '1';
+            IRQ_status    <= (others => '0');
+        elsif rising_edge(clk) then
+            SW_meta       <= SW;
+            SW_sync       <= SW_meta;
+            SW_last       <= SW_sync;
+            Pattern_last  <= Pattern;
+            fifo_low_last <= fifo_low;
+
+            events := IRQ_raise;
+            if PB then
+                events(IRQ_PB) := '1';
+            end if;
+            if SW_sync /= SW_last then
+                events(IRQ_SW) := '1';
+            end if;
+            if Pattern /= Pattern_last then
+                events(IRQ_PATTERN) := '1';
+            end if;
+            if fifo_low = '1' and fifo_low_last = '0' then
+                events(IRQ_FIFO) := '1';
+            end if;
+            IRQ_status <= (IRQ_status and not IRQ_clear) or events;
         end if;
     end process;
 
+    irq <= '1' when (IRQ_status and IRQ_mask) /= (IRQ_status'range => '0') else '0';
+
+    -- Pattern table port A: Avalon reads and writes
+    -- Only one of a read or write beat can occur in any cycle, so they share
+    -- one RAM port
+    table_entry_a <= to_integer(write_addr(PATTERN_TABLE_BITS downto 1)) when write_beat = '1' else
+                     to_integer(read_addr(PATTERN_TABLE_BITS downto 1));
+
+    pattern_table_avalon : process (clk) is
+    begin
+        if rising_edge(clk) then
+            if write_beat = '1' and write_addr(9 downto 8) = "01" then
+                if write_addr(0) = '0' then
+                    if avs_s1_byteenable(0) then
+                        led_table(table_entry_a) <= avs_s1_writedata(TABLE_LED_WIDTH - 1 downto 0);
+                    end if;
+                else
+                    if avs_s1_byteenable(0) then
+                        duration_table(table_entry_a)(7 downto 0) <= unsigned(avs_s1_writedata(7 downto 0));
+                    end if;
+                    if avs_s1_byteenable(1) then
+                        duration_table(table_entry_a)(15 downto 8) <= unsigned(avs_s1_writedata(15 downto 8));
+                    end if;
+                end if;
+            end if;
+            table_led_a      <= led_table(table_entry_a);
+            table_duration_a <= duration_table(table_entry_a);
+        end if;
+    end process;
+
+    -- Pattern table port B: pattern player reads
+    pattern_table_player : process (clk) is
+    begin
+        if rising_edge(clk) then
+            table_led_b      <= led_table(to_integer(table_index_b));
+            table_duration_b <= duration_table(to_integer(table_index_b));
+        end if;
+    end process;
+
+    -- Gamma table port A: Avalon reads and writes, sharing one RAM port as
+    -- for the pattern table
+    gamma_table_avalon : process (clk) is
+        variable entry : natural range 0 to 255;
+    begin
+        if rising_edge(clk) then
+            if write_beat = '1' then
+                entry := to_integer(write_addr(7 downto 0));
+            else
+                entry := to_integer(read_addr(7 downto 0));
+            end if;
+            if write_beat = '1' and write_addr(9 downto 8) = "11" and avs_s1_byteenable(0) = '1' then
+                gamma_table(entry) <= unsigned(avs_s1_writedata(7 downto 0));
+            end if;
+            gamma_a <= gamma_table(entry);
+        end if;
+    end process;
+
+    -- Gamma table port B: look up one LED's brightness per cycle, round
+    -- robin, so every duty cycle follows its brightness (and the gamma table)
+    -- within PWM_WIDTH + 1 cycles
+    gamma_table_scan : process (clk) is
+    begin
+        if rising_edge(clk) then
+            gamma_b <= gamma_table(to_integer(unsigned(Brightness(pwm_scan))));
+        end if;
+    end process;
+
+    pwm_duty_scan : process (clk, reset) is
+    begin
+        if reset then
+            pwm_scan      <= 0;
+            pwm_scan_last <= 0;
+            pwm_duty      <= (others => x"FF");
+        elsif rising_edge(clk) then
+            if pwm_scan = PWM_WIDTH - 1 then
+                pwm_scan <= 0;
+            else
+                pwm_scan <= pwm_scan + 1;
+            end if;
+            pwm_scan_last <= pwm_scan;
+            -- The first lookup after reset is still in flight
+            if pwm_scan /= pwm_scan_last then
+                pwm_duty(pwm_scan_last) <= std_logic_vector(gamma_b);
+            end if;
+        end if;
+    end process;
+
+    -- PWM generator
+    -- Each LED is allowed on for the first pwm_duty of every PWM_STEPS steps,
+    -- so a duty cycle of 0 is always off and 255 always on
+    pwm_generator : process (clk, reset) is
+    begin
+        if reset then
+            pwm_step     <= 0;
+            pwm_prescale <= 0;
+            pwm_mask     <= (others => '1');
+        elsif rising_edge(clk) then
+            if pwm_prescale = PWM_STEP_CYCLES - 1 then
+                pwm_prescale <= 0;
+                if pwm_step = PWM_STEPS - 1 then
+                    pwm_step <= 0;
+                else
+                    pwm_step <= pwm_step + 1;
+                end if;
+            else
+                pwm_prescale <= pwm_prescale + 1;
+            end if;
+            for i in 0 to PWM_WIDTH - 1 loop
+                if pwm_step < to_integer(unsigned(pwm_duty(i))) then
+                    pwm_mask(i) <= '1';
+                else
+                    pwm_mask(i) <= '0';
+                end if;
+            end loop;
+        end if;
+    end process;
+
+    -- Dim the LEDs, on top of whatever LED_Patterns drives them with
+    LED <= LED_on and pwm_mask;
+
     -- Instantiate the LED_Patterns component
     patterns : LED_Patterns
         generic map (
-            SYS_CLKs_sec => to_unsigned(50000000, 26)
+            SYS_CLKs_sec => SYS_CLKs_sec,
+            LED_WIDTH    => LED_WIDTH
         )
         port map (
             clk             => clk,
@@ -116,8 +832,22 @@ begin
             SW              => SW,
             HPS_LED_control => HPS_LED_control,
             Base_rate       => Base_rate,
+            Base_period     => Base_period,
             LED_reg         => LED_reg,
-            LED             => LED
+            Player_start    => Player_start,
+            Player_stop     => Player_stop,
+            Player_loop     => Player_loop,
+            Player_first    => Player_first,
+            Player_length   => Player_length,
+            Player_busy     => Player_busy,
+            Player_index    => Player_index,
+            Table_index     => table_index_b,
+            Table_LED       => table_led_b,
+            Table_duration  => table_duration_b,
+            Pattern_select  => Pattern_select,
+            Pattern_load    => Pattern_load,
+            Pattern         => Pattern,
+            LED             => LED_on
         );
 
 end architecture;
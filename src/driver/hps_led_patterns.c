@@ -12,12 +12,34 @@
 #include <linux/fs.h>
 #include <linux/kernel.h>
 #include <linux/uaccess.h>
+#include <linux/string.h>
+#include <linux/slab.h>
+#include <linux/interrupt.h>
+#include <linux/input.h>
+#include <linux/poll.h>
+#include <linux/spinlock.h>
+#include <linux/wait.h>
+#include <linux/ctype.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/firmware.h>
+#include <linux/completion.h>
+#include <linux/of.h>
 
 //-----------------------------------------------------------------------
 // DEFINE STATEMENTS
 //-----------------------------------------------------------------------
 #include "reg_offsets.h"
 
+// Maximum number of words moved by a single char device read() or write()
+// call; larger requests return a short count, as usual for read()/write()
+#define MAX_TRANSFER_WORDS 64
+
+// Pattern table loaded through the firmware loader at probe, unless the
+// device tree node gives a firmware-name
+#define DEFAULT_PATTERN_FIRMWARE "hps_led_patterns.pat"
+#define PATTERN_FIRMWARE_NAME_MAX 64
+
 
 //-----------------------------------------------------------------------
 // HELPER FUNCTIONS
@@ -78,148 +100,2108 @@ u8 str2UQ44(const char *buf, size_t size) {
 }
 
 
+/**
+ * str2ns() - Convert a decimal number of seconds to nanoseconds.
+ * @buf: Buffer that contains the decimal string to parse.
+ * @size: The length of the buffer.
+ * @ns: Destination for the result.
+ *
+ * Digits past the ninth fractional place are ignored.
+ *
+ * Return: 0 on success, -EINVAL if the string is not a decimal number, or
+ *         -ERANGE if it does not fit in 64 bits of nanoseconds.
+ */
+static int str2ns(const char *buf, size_t size, u64 *ns)
+{
+    u64 ipart = 0, fpart = 0;
+    u32 scale = NSEC_PER_SEC;
+    bool digits = false;
+    size_t i = 0;
+
+    // Integer part
+    for (; (i < size) && isdigit(buf[i]); i++) {
+        if (ipart > (U64_MAX - 9) / 10)
+            return -ERANGE;
+        ipart = 10*ipart + (buf[i] - '0');
+        digits = true;
+    }
+    // Fractional part, keeping only nanoseconds
+    if ((i < size) && (buf[i] == '.')) {
+        for (i++; (i < size) && isdigit(buf[i]); i++) {
+            if (scale > 1) {
+                scale /= 10;
+                fpart += (buf[i] - '0') * scale;
+            }
+            digits = true;
+        }
+    }
+    // Allow a trailing newline, as left by echo
+    if ((i < size) && (buf[i] == '\n'))
+        i++;
+    if (!digits || ((i < size) && (buf[i] != '\0')))
+        return -EINVAL;
+
+    if (ipart > (U64_MAX - fpart) / NSEC_PER_SEC)
+        return -ERANGE;
+    *ns = ipart * NSEC_PER_SEC + fpart;
+    return 0;
+}
+
+
+/**
+ * str2leds() - Parse an LED bitmap of arbitrary width.
+ * @buf: Buffer that contains the bitmap, as a hexadecimal number with an
+ *       optional "0x" prefix.
+ * @size: The length of the buffer.
+ * @words: Destination for the bitmap, least significant word first; must
+ *         hold DIV_ROUND_UP(@width, 32) words.
+ * @width: The number of LEDs.
+ *
+ * Return: 0 on success, -EINVAL if the string isn't a hexadecimal number, or
+ *         -ERANGE if it sets bits beyond @width.
+ */
+int str2leds(const char *buf, size_t size, u32 *words, u32 width) {
+    size_t start = 0;
+    size_t end = strnlen(buf, size);
+    u32 bit = 0;
+    // Ignore trailing whitespace (such as the newline from echo) and the
+    // optional prefix
+    while (end > 0 && isspace(buf[end - 1]))
+        end--;
+    if (end >= 2 && buf[0] == '0' && tolower(buf[1]) == 'x')
+        start = 2;
+    if (start == end)
+        return -EINVAL;
+
+    memset(words, 0, DIV_ROUND_UP(width, 32) * sizeof(*words));
+    // Work up from the least significant digit
+    for (size_t i = end; i > start; i--, bit += 4) {
+        int digit = hex_to_bin(buf[i - 1]);
+        if (digit < 0)
+            return -EINVAL;
+        if (digit == 0)
+            continue;
+        // Check for LEDs that don't exist
+        if (bit >= width || (width - bit < 4 && (digit >> (width - bit))))
+            return -ERANGE;
+        words[bit / 32] |= (u32)digit << (bit % 32);
+    }
+    return 0;
+}
+
+
+/**
+ * str2bytes() - Parse a whitespace-separated list of byte values.
+ * @buf: Buffer that contains the list, with each value in any base
+ *       kstrtou8() accepts.
+ * @size: The length of the buffer.
+ * @vals: Destination for the values.
+ * @max: The most values @vals can hold.
+ *
+ * Return: The number of values parsed, -EINVAL if there are none or one isn't
+ *         a number, or -ERANGE if one doesn't fit in a byte or there are more
+ *         than @max.
+ */
+static int str2bytes(const char *buf, size_t size, u8 *vals, u32 max)
+{
+    u32 count = 0;
+    size_t i = 0;
+
+    while (true) {
+        char token[8];
+        size_t len = 0;
+        int ret;
+
+        while ((i < size) && isspace(buf[i]))
+            i++;
+        if ((i >= size) || (buf[i] == '\0'))
+            break;
+        for (; (i < size) && buf[i] && !isspace(buf[i]); i++, len++) {
+            if (len < sizeof(token) - 1)
+                token[len] = buf[i];
+        }
+        if (len >= sizeof(token))
+            return -ERANGE;
+        token[len] = '\0';
+        if (count == max)
+            return -ERANGE;
+        ret = kstrtou8(token, 0, &vals[count]);
+        if (ret < 0)
+            return ret;
+        count++;
+    }
+    return count ? count : -EINVAL;
+}
+
+
+//-----------------------------------------------------------------------
+// HPS_LED_Patterns device structure
+//-----------------------------------------------------------------------
+/**
+ * struct  hps_led_patterns_dev - Private hps_led_patterns device struct.
+ * @miscdev: miscdevice used to create a char device for the hps_led_patterns
+ *           component
+ * @base_addr: Base address of the hps_led_patterns component
+ * @led_width: Number of LEDs, from the capability register
+ * @led_words: Number of 32-bit words spanned by LED_reg
+ * @caps: Capability register contents, including its feature flags
+ * @fifo_depth: Number of write FIFO entries, or 0 if there is no write FIFO
+ * @pwm_width: Number of LEDs with PWM brightness, or 0 if there is no PWM
+ * @lock: mutex used to prevent concurrent writes to the hps_led_patterns
+ *        component
+ * @reg_lock: Spinlock taken by single-word char device writes, which skip
+ *            @lock, and by every read-modify-write of a register they can
+ *            reach, so those writes can't land between the read and the write
+ * @input: Input device reporting pushbutton, switch and pattern events
+ * @event_wait: Wait queue for poll() callers waiting on events
+ * @event_lock: Spinlock protecting @events
+ * @events: IRQ status bits seen since user space last cleared them via the
+ *          irq_events attribute
+ * @fw_lock: mutex serializing pattern firmware loads, and protecting @fw_name
+ * @fw_name: Pattern firmware file requested at probe, or last loaded through
+ *           the pattern_firmware attribute
+ * @fw_done: Completed once the pattern firmware requested at probe has been
+ *           handled, so remove doesn't race with it
+ *
+ * An hps_led_patterns_dev struct gets created for each hps_led_patterns
+ * component in the system.
+ */
+struct hps_led_patterns_dev {
+    struct miscdevice miscdev;
+    void __iomem *base_addr;
+    u32 led_width;
+    u32 led_words;
+    u32 caps;
+    u32 fifo_depth;
+    u32 pwm_width;
+    struct mutex lock;
+    spinlock_t reg_lock;
+    struct input_dev *input;
+    wait_queue_head_t event_wait;
+    spinlock_t event_lock;
+    u32 events;
+    struct mutex fw_lock;
+    char fw_name[PATTERN_FIRMWARE_NAME_MAX];
+    struct completion fw_done;
+};
+
+
+//-----------------------------------------------------------------------
+// Pattern table bulk access
+//-----------------------------------------------------------------------
+/**
+ * pattern_table_read() - Read consecutive pattern table entries.
+ * @priv: hps_led_patterns device to read from.
+ * @first: First table entry to read; entries past the end of the table wrap
+ *         around to entry 0.
+ * @count: Number of entries to read.
+ * @words: Destination for 2 * @count words, holding each entry's LED value
+ *         followed by its duration.
+ *
+ * Reads are issued back to back, without a barrier between each one, so the
+ * bridge can keep several in flight at once; a single barrier afterwards
+ * orders them against whatever the caller does next.
+ */
+static void pattern_table_read(struct hps_led_patterns_dev *priv, u32 first,
+    u32 count, u32 *words)
+{
+    for (u32 i = 0; i < count; i++) {
+        u32 entry = (first + i) % PATTERN_TABLE_ENTRIES;
+        words[2*i] = readl_relaxed(priv->base_addr + PATTERN_TABLE_LED_OFFSET(entry));
+        words[2*i + 1] = readl_relaxed(priv->base_addr + PATTERN_TABLE_DURATION_OFFSET(entry));
+    }
+    rmb();
+}
+
+/**
+ * pattern_table_parse() - Parse a pattern table from text.
+ * @buf: Buffer that contains one "LED DURATION" entry per line, with the LED
+ *       value in hexadecimal and the duration in decimal Base_rate ticks; it
+ *       need not be NUL-terminated.
+ * @size: The length of the buffer.
+ * @words: Destination for up to PATTERN_TABLE_ENTRIES entries, as in
+ *         pattern_table_write().
+ *
+ * Lines that don't parse (such as blank lines) are skipped, as are any
+ * entries past the end of the table.
+ *
+ * Return: The number of entries parsed.
+ */
+static u32 pattern_table_parse(const char *buf, size_t size, u32 *words)
+{
+    const char *line = buf;
+    const char *end = buf + size;
+    u32 entries = 0;
+
+    while (line < end && entries < PATTERN_TABLE_ENTRIES) {
+        const char *next = memchr(line, '\n', end - line);
+        size_t len = (next ? next : end) - line;
+        char entry_buf[32];
+        unsigned int led, duration;
+        // Parse each line on its own, so sscanf() can't run across lines
+        if (len >= sizeof(entry_buf)) {
+            line = next ? next + 1 : end;
+            continue;
+        }
+        memcpy(entry_buf, line, len);
+        entry_buf[len] = '\0';
+        if (sscanf(entry_buf, "%x %u", &led, &duration) == 2) {
+            words[2*entries] = led;
+            words[2*entries + 1] = duration;
+            entries++;
+        }
+        line = next ? next + 1 : end;
+    }
+    return entries;
+}
+
+/**
+ * pattern_table_write() - Write consecutive pattern table entries.
+ * @priv: hps_led_patterns device to write to.
+ * @first: First table entry to write; entries past the end of the table wrap
+ *         around to entry 0.
+ * @count: Number of entries to write.
+ * @words: 2 * @count words, holding each entry's LED value followed by its
+ *         duration.
+ *
+ * As with pattern_table_read(), writes are posted back to back, followed by a
+ * single barrier.
+ */
+static void pattern_table_write(struct hps_led_patterns_dev *priv, u32 first,
+    u32 count, const u32 *words)
+{
+    for (u32 i = 0; i < count; i++) {
+        u32 entry = (first + i) % PATTERN_TABLE_ENTRIES;
+        writel_relaxed(words[2*i], priv->base_addr + PATTERN_TABLE_LED_OFFSET(entry));
+        writel_relaxed(words[2*i + 1], priv->base_addr + PATTERN_TABLE_DURATION_OFFSET(entry));
+    }
+    wmb();
+}
+
+
+//-----------------------------------------------------------------------
+// Write FIFO bulk access
+//-----------------------------------------------------------------------
+/**
+ * fifo_room() - Return the number of free write FIFO entries.
+ * @priv: hps_led_patterns device to query.
+ *
+ * Return: The number of entries that can be pushed without overflowing.
+ */
+static u32 fifo_room(struct hps_led_patterns_dev *priv)
+{
+    u32 level = ioread32(priv->base_addr + REG17_FIFO_LEVEL_OFFSET);
+
+    return level < priv->fifo_depth ? priv->fifo_depth - level : 0;
+}
+
+/**
+ * fifo_push() - Push entries onto the write FIFO.
+ * @priv: hps_led_patterns device to write to.
+ * @count: Number of entries to push; the caller must have checked that they
+ *         fit, with fifo_room().
+ * @words: 2 * @count words, holding each entry's LED value followed by its
+ *         hold time in clock cycles.
+ *
+ * Entries cycle through the push window, so they go out as consecutive
+ * writes regardless of their number. As with pattern_table_write(), writes
+ * are posted back to back, followed by a single barrier.
+ */
+static void fifo_push(struct hps_led_patterns_dev *priv, u32 count,
+    const u32 *words)
+{
+    for (u32 i = 0; i < count; i++) {
+        u32 offset = FIFO_PUSH_OFFSET + (2*i % FIFO_PUSH_WORDS) * sizeof(u32);
+        writel_relaxed(words[2*i], priv->base_addr + offset);
+        writel_relaxed(words[2*i + 1], priv->base_addr + offset + sizeof(u32));
+    }
+    wmb();
+}
+
+
+//-----------------------------------------------------------------------
+// 64-bit register access
+//-----------------------------------------------------------------------
+/**
+ * read_latched64() - Read a 64-bit value split across a low/high word pair.
+ * @priv: hps_led_patterns device to read from.
+ * @lo_offset: Offset of the low word; the high word follows it.
+ *
+ * Reading the low word latches the high word in hardware, so the pair is
+ * consistent as long as nobody else reads a low word in between. The caller
+ * must hold @priv->lock, which every path that reads these words takes.
+ *
+ * Return: The 64-bit value.
+ */
+static u64 read_latched64(struct hps_led_patterns_dev *priv, u32 lo_offset)
+{
+    u32 lo, hi;
+
+    lockdep_assert_held(&priv->lock);
+    lo = ioread32(priv->base_addr + lo_offset);
+    hi = ioread32(priv->base_addr + lo_offset + 0x4);
+    return ((u64)hi << 32) | lo;
+}
+
+
+//-----------------------------------------------------------------------
+// REG0: HPS_LED_control register read function show()
+//-----------------------------------------------------------------------
+/**
+ * hps_led_control_show() - Return the hps_led_control value to user-space via
+ *                          sysfs.
+ * @dev: Device structure for the hps_led_patterns component. This device
+ *       struct is embedded in the hps_led_patterns' device struct.
+ * @attr: Unused.
+ * @buf: Buffer that gets returned to user-space.
+ *
+ * Return: The number of bytes read.
+ */
+static ssize_t hps_led_control_show(struct device *dev,
+    struct device_attribute *attr, char *buf)
+{
+    // Get the private hps_led_patterns data out of the dev struct
+    struct hps_led_patterns_dev *priv = dev_get_drvdata(dev);
+
+    bool hps_control = ioread32(priv->base_addr + REG0_HPS_LED_CONTROL_OFFSET);
+
+    return scnprintf(buf, PAGE_SIZE, "%u\n", hps_control);
+}
+
+//-----------------------------------------------------------------------
+// REG0: HPS_LED_control register write function store()
+//-----------------------------------------------------------------------
+/**
+ * hps_led_control_store() - Store the hps_led_control value.
+ * @dev: Device structure for the hps_led_patterns component. This device
+ *       struct is embedded in the hps_led_patterns' platform device struct.
+ * @attr: Unused.
+ * @buf: Buffer that contains the hps_led_control value being written.
+ * @size: The number of bytes being written.
+ *
+ * Return: The number of bytes stored.
+ */
+static ssize_t hps_led_control_store(struct device *dev,
+    struct device_attribute *attr, const char *buf, size_t size)
+{
+    struct hps_led_patterns_dev *priv = dev_get_drvdata(dev);
+
+    // Parse the string we received as a bool
+    // See https://elixir.bootlin.com/linux/latest/source/lib/kstrtox.c#L289
+    bool hps_control;
+    int ret = kstrtobool(buf, &hps_control);
+    if (ret < 0) {
+        // kstrtobool returned an error
+        return ret;
+    }
+
+    iowrite32(hps_control, priv->base_addr + REG0_HPS_LED_CONTROL_OFFSET);
+
+    // Write was succesful, so we return the number of bytes we wrote.
+    return size;
+}
+
+
+//-----------------------------------------------------------------------
+// REG1: LED_reg register read function show()
+//-----------------------------------------------------------------------
+/**
+ * led_reg_show() - Return the led_reg value to user-space via sysfs.
+ * @dev: Device structure for the hps_led_patterns component. This
+ *       device struct is embedded in the hps_led_patterns' platform
+ *       device struct.
+ * @attr: Unused.
+ * @buf: Buffer that gets returned to user-space.
+ *
+ * Return: The number of bytes read.
+ */
+static ssize_t led_reg_show(struct device *dev,
+    struct device_attribute *attr, char *buf)
+{
+    struct hps_led_patterns_dev *priv = dev_get_drvdata(dev);
+
+    // Print one hex digit per four LEDs, most significant word first
+    int top_digits = DIV_ROUND_UP(priv->led_width - 32 * (priv->led_words - 1), 4);
+    ssize_t len;
+    u32 word = priv->led_words - 1;
+
+    mutex_lock(&priv->lock);
+    len = scnprintf(buf, PAGE_SIZE, "0x%0*X", top_digits,
+                    ioread32(priv->base_addr + LED_WORD_OFFSET(word)));
+    while (word-- > 0)
+        len += scnprintf(buf + len, PAGE_SIZE - len, "%08X",
+                         ioread32(priv->base_addr + LED_WORD_OFFSET(word)));
+    mutex_unlock(&priv->lock);
+    len += scnprintf(buf + len, PAGE_SIZE - len, "\n");
+
+    return len;
+}
+
+//-----------------------------------------------------------------------
+// REG1: LED_reg register write function store()
+//-----------------------------------------------------------------------
+/**
+ * led_reg_store() - Store the led_reg value.
+ * @dev: Device structure for the hps_led_patterns component. This
+ *       device struct is embedded in the hps_led_patterns' platform
+ *       device struct.
+ * @attr: Unused.
+ * @buf: Buffer that contains the  hps_led_patterns value being written.
+ * @size: The number of bytes being written.
+ *
+ * Up to 32 LEDs, the value may be given in any base kstrtou32() accepts;
+ * beyond that, it must be hexadecimal. Each word of LEDs takes one bus write.
+ *
+ * Return: The number of bytes stored.
+ */
+static ssize_t led_reg_store(struct device *dev,
+    struct device_attribute *attr, const char *buf, size_t size)
+{
+    struct hps_led_patterns_dev *priv = dev_get_drvdata(dev);
+
+    u32 *words;
+    int ret;
+
+    words = kmalloc_array(priv->led_words, sizeof(*words), GFP_KERNEL);
+    if (!words)
+        return -ENOMEM;
+
+    if (priv->led_width <= 32) {
+        // Parse the string we received as a u32
+        // See https://elixir.bootlin.com/linux/latest/source/lib/kstrtox.c#L289
+        ret = kstrtou32(buf, 0, &words[0]);
+        if (ret == 0 && priv->led_width < 32 && (words[0] >> priv->led_width))
+            ret = -ERANGE;
+    } else {
+        ret = str2leds(buf, size, words, priv->led_width);
+    }
+    if (ret < 0) {
+        // Parsing failed, so return its error code
+        kfree(words);
+        return ret;
+    }
+
+    mutex_lock(&priv->lock);
+    for (u32 i = 0; i < priv->led_words; i++)
+        writel_relaxed(words[i], priv->base_addr + LED_WORD_OFFSET(i));
+    wmb();
+    mutex_unlock(&priv->lock);
+    kfree(words);
+
+    // Write was succesful, so we return the number of bytes we wrote.
+    return size;
+}
+
+
+//-----------------------------------------------------------------------
+// LED width read function show()
+//-----------------------------------------------------------------------
+/**
+ * led_width_show() - Return the number of LEDs to user-space via sysfs.
+ * @dev: Device structure for the hps_led_patterns component. This
+ *       device struct is embedded in the hps_led_patterns' platform
+ *       device struct.
+ * @attr: Unused.
+ * @buf: Buffer that gets returned to user-space.
+ *
+ * Return: The number of bytes read.
+ */
+static ssize_t led_width_show(struct device *dev,
+    struct device_attribute *attr, char *buf)
+{
+    struct hps_led_patterns_dev *priv = dev_get_drvdata(dev);
+
+    return scnprintf(buf, PAGE_SIZE, "%u\n", priv->led_width);
+}
+
+
+//-----------------------------------------------------------------------
+// REG2: Base_rate register read function show()
+//-----------------------------------------------------------------------
+/**
+ * base_rate_show() - Return the led_reg value to user-space via sysfs.
+ * @dev: Device structure for the hps_led_patterns component. This
+ *       device struct is embedded in the hps_led_patterns' platform
+ *       device struct.
+ * @attr: Unused.
+ * @buf: Buffer that gets returned to user-space.
+ *
+ * Return: The number of bytes read.
+ */
+static ssize_t base_rate_show(struct device *dev,
+    struct device_attribute *attr, char *buf)
+{
+    struct hps_led_patterns_dev *priv = dev_get_drvdata(dev);
+
+    u8 base_rate = ioread32(priv->base_addr + REG2_BASE_RATE_OFFSET);
+    // Break the register into its integer and fractional parts
+    unsigned int ipart = base_rate >> 4;
+    unsigned int fpart = (base_rate & 0x0F) * 625;
+
+    return scnprintf(buf, PAGE_SIZE, "%u.%04u\t0x%X\n", ipart, fpart, base_rate);
+}
+
+//-----------------------------------------------------------------------
+// REG2: Base_rate register write function store()
+//-----------------------------------------------------------------------
+/**
+ * base_rate_store() - Store the led_reg value.
+ * @dev: Device structure for the hps_led_patterns component. This
+ *       device struct is embedded in the hps_led_patterns' platform
+ *       device struct.
+ * @attr: Unused.
+ * @buf: Buffer that contains the  hps_led_patterns value being written.
+ * @size: The number of bytes being written.
+ *
+ * The hardware also clears Base_period, so that base_rate takes effect.
+ *
+ * Return: The number of bytes stored.
+ */
+static ssize_t base_rate_store(struct device *dev,
+    struct device_attribute *attr, const char *buf, size_t size)
+{
+    struct hps_led_patterns_dev *priv = dev_get_drvdata(dev);
+
+    // Parse the string we received as a UQ4.4
+    u8 base_rate;
+    base_rate = str2UQ44(buf, size);
+
+    iowrite32(base_rate, priv->base_addr + REG2_BASE_RATE_OFFSET);
+    // Return the number of bytes we wrote
+    return size;
+}
+
+
+//-----------------------------------------------------------------------
+// REG22: Base_period register read function show()
+//-----------------------------------------------------------------------
+/**
+ * base_period_show() - Return the base transition period in effect to
+ *                      user-space via sysfs.
+ * @dev: Device structure for the hps_led_patterns component. This
+ *       device struct is embedded in the hps_led_patterns' platform
+ *       device struct.
+ * @attr: Unused.
+ * @buf: Buffer that gets returned to user-space.
+ *
+ * The period is shown in seconds (to the nanosecond), followed by the same
+ * period in system clock cycles. While Base_period is zero, this is the
+ * period given by base_rate.
+ *
+ * Return: The number of bytes read.
+ */
+static ssize_t base_period_show(struct device *dev,
+    struct device_attribute *attr, char *buf)
+{
+    struct hps_led_patterns_dev *priv = dev_get_drvdata(dev);
+
+    u32 freq, period, base_rate;
+    u64 cycles, ns;
+    u32 rem;
+
+    if (!(priv->caps & CAP_BASE_PERIOD))
+        return -ENODEV;
+
+    mutex_lock(&priv->lock);
+    freq = ioread32(priv->base_addr + REG15_CLOCK_FREQ_OFFSET);
+    period = ioread32(priv->base_addr + REG22_BASE_PERIOD_OFFSET);
+    base_rate = ioread32(priv->base_addr + REG2_BASE_RATE_OFFSET) & 0xFF;
+    mutex_unlock(&priv->lock);
+
+    // Base_rate is a UQ4.4 number of seconds
+    if (period)
+        cycles = period;
+    else
+        cycles = div_u64((u64)base_rate * freq, 16);
+
+    ns = div_u64(cycles * NSEC_PER_SEC, freq);
+    ns = div_u64_rem(ns, NSEC_PER_SEC, &rem);
+    return scnprintf(buf, PAGE_SIZE, "%llu.%09u\t%llu\n", ns, rem, cycles);
+}
+
+//-----------------------------------------------------------------------
+// REG22: Base_period register write function store()
+//-----------------------------------------------------------------------
+/**
+ * base_period_store() - Set the base transition period, with clock-cycle
+ *                       resolution.
+ * @dev: Device structure for the hps_led_patterns component. This
+ *       device struct is embedded in the hps_led_patterns' platform
+ *       device struct.
+ * @attr: Unused.
+ * @buf: Buffer that contains the period, as a decimal number of seconds.
+ * @size: The number of bytes being written.
+ *
+ * The period is rounded to the nearest system clock cycle, and replaces
+ * base_rate until base_rate is next written; a period of 0 goes back to
+ * base_rate. Periods under 16 cycles run the built-in patterns and the
+ * player as fast as the hardware can, one fine tick per cycle.
+ *
+ * Return: The number of bytes stored, or -ERANGE if the period does not fit
+ *         in 32 bits of clock cycles.
+ */
+static ssize_t base_period_store(struct device *dev,
+    struct device_attribute *attr, const char *buf, size_t size)
+{
+    struct hps_led_patterns_dev *priv = dev_get_drvdata(dev);
+
+    u32 freq;
+    u64 ns, cycles;
+    int ret;
+
+    if (!(priv->caps & CAP_BASE_PERIOD))
+        return -ENODEV;
+
+    ret = str2ns(buf, size, &ns);
+    if (ret < 0)
+        return ret;
+
+    freq = ioread32(priv->base_addr + REG15_CLOCK_FREQ_OFFSET);
+    // Periods past U32_MAX cycles are out of range anyway, so the product
+    // only needs to be checked for overflow
+    if (ns > (U64_MAX - NSEC_PER_SEC / 2) / freq)
+        return -ERANGE;
+    cycles = div_u64(ns * freq + NSEC_PER_SEC / 2, NSEC_PER_SEC);
+    if (cycles > U32_MAX)
+        return -ERANGE;
+
+    mutex_lock(&priv->lock);
+    iowrite32(cycles, priv->base_addr + REG22_BASE_PERIOD_OFFSET);
+    mutex_unlock(&priv->lock);
+
+    // Return the number of bytes we wrote
+    return size;
+}
+
+
+//-----------------------------------------------------------------------
+// REG3: Player_control register read function show()
+//-----------------------------------------------------------------------
+/**
+ * player_run_show() - Return whether the pattern player is running to
+ *                     user-space via sysfs.
+ * @dev: Device structure for the hps_led_patterns component. This
+ *       device struct is embedded in the hps_led_patterns' platform
+ *       device struct.
+ * @attr: Unused.
+ * @buf: Buffer that gets returned to user-space.
+ *
+ * Return: The number of bytes read.
+ */
+static ssize_t player_run_show(struct device *dev,
+    struct device_attribute *attr, char *buf)
+{
+    struct hps_led_patterns_dev *priv = dev_get_drvdata(dev);
+
+    bool busy = ioread32(priv->base_addr + REG3_PLAYER_CONTROL_OFFSET)
+        & PLAYER_CONTROL_BUSY;
+
+    return scnprintf(buf, PAGE_SIZE, "%u\n", busy);
+}
+
+//-----------------------------------------------------------------------
+// REG3: Player_control register write function store()
+//-----------------------------------------------------------------------
+/**
+ * player_run_store() - Start or stop the pattern player.
+ * @dev: Device structure for the hps_led_patterns component. This
+ *       device struct is embedded in the hps_led_patterns' platform
+ *       device struct.
+ * @attr: Unused.
+ * @buf: Buffer that contains a boolean; true starts the player from
+ *       player_first, and false stops it.
+ * @size: The number of bytes being written.
+ *
+ * Return: The number of bytes stored.
+ */
+static ssize_t player_run_store(struct device *dev,
+    struct device_attribute *attr, const char *buf, size_t size)
+{
+    struct hps_led_patterns_dev *priv = dev_get_drvdata(dev);
+
+    bool run;
+    int ret = kstrtobool(buf, &run);
+    if (ret < 0) {
+        // kstrtobool returned an error
+        return ret;
+    }
+
+    iowrite32(run ? PLAYER_CONTROL_START : PLAYER_CONTROL_STOP,
+        priv->base_addr + REG3_PLAYER_CONTROL_OFFSET);
+
+    // Write was succesful, so we return the number of bytes we wrote.
+    return size;
+}
+
+
+//-----------------------------------------------------------------------
+// REG4: Player_loop register read function show()
+//-----------------------------------------------------------------------
+/**
+ * player_loop_show() - Return the player_loop value to user-space via sysfs.
+ * @dev: Device structure for the hps_led_patterns component. This
+ *       device struct is embedded in the hps_led_patterns' platform
+ *       device struct.
+ * @attr: Unused.
+ * @buf: Buffer that gets returned to user-space.
+ *
+ * Return: The number of bytes read.
+ */
+static ssize_t player_loop_show(struct device *dev,
+    struct device_attribute *attr, char *buf)
+{
+    struct hps_led_patterns_dev *priv = dev_get_drvdata(dev);
+
+    bool loop = ioread32(priv->base_addr + REG4_PLAYER_LOOP_OFFSET);
+
+    return scnprintf(buf, PAGE_SIZE, "%u\n", loop);
+}
+
+//-----------------------------------------------------------------------
+// REG4: Player_loop register write function store()
+//-----------------------------------------------------------------------
+/**
+ * player_loop_store() - Store the player_loop value.
+ * @dev: Device structure for the hps_led_patterns component. This
+ *       device struct is embedded in the hps_led_patterns' platform
+ *       device struct.
+ * @attr: Unused.
+ * @buf: Buffer that contains the player_loop value being written.
+ * @size: The number of bytes being written.
+ *
+ * Return: The number of bytes stored.
+ */
+static ssize_t player_loop_store(struct device *dev,
+    struct device_attribute *attr, const char *buf, size_t size)
+{
+    struct hps_led_patterns_dev *priv = dev_get_drvdata(dev);
+
+    bool loop;
+    int ret = kstrtobool(buf, &loop);
+    if (ret < 0) {
+        // kstrtobool returned an error
+        return ret;
+    }
+
+    iowrite32(loop, priv->base_addr + REG4_PLAYER_LOOP_OFFSET);
+
+    // Write was succesful, so we return the number of bytes we wrote.
+    return size;
+}
+
+
+//-----------------------------------------------------------------------
+// REG5: Player_first register read function show()
+//-----------------------------------------------------------------------
+/**
+ * player_first_show() - Return the player_first value to user-space via
+ *                       sysfs.
+ * @dev: Device structure for the hps_led_patterns component. This
+ *       device struct is embedded in the hps_led_patterns' platform
+ *       device struct.
+ * @attr: Unused.
+ * @buf: Buffer that gets returned to user-space.
+ *
+ * Return: The number of bytes read.
+ */
+static ssize_t player_first_show(struct device *dev,
+    struct device_attribute *attr, char *buf)
+{
+    struct hps_led_patterns_dev *priv = dev_get_drvdata(dev);
+
+    u32 first = ioread32(priv->base_addr + REG5_PLAYER_FIRST_OFFSET);
+
+    return scnprintf(buf, PAGE_SIZE, "%u\n", first);
+}
+
+//-----------------------------------------------------------------------
+// REG5: Player_first register write function store()
+//-----------------------------------------------------------------------
+/**
+ * player_first_store() - Store the player_first value.
+ * @dev: Device structure for the hps_led_patterns component. This
+ *       device struct is embedded in the hps_led_patterns' platform
+ *       device struct.
+ * @attr: Unused.
+ * @buf: Buffer that contains the index of the first table entry to play.
+ * @size: The number of bytes being written.
+ *
+ * Return: The number of bytes stored.
+ */
+static ssize_t player_first_store(struct device *dev,
+    struct device_attribute *attr, const char *buf, size_t size)
+{
+    struct hps_led_patterns_dev *priv = dev_get_drvdata(dev);
+
+    u32 first;
+    int ret = kstrtou32(buf, 0, &first);
+    if (ret < 0) {
+        // kstrtou32 returned an error
+        return ret;
+    }
+    if (first >= PATTERN_TABLE_ENTRIES)
+        return -EINVAL;
+
+    iowrite32(first, priv->base_addr + REG5_PLAYER_FIRST_OFFSET);
+
+    // Write was succesful, so we return the number of bytes we wrote.
+    return size;
+}
+
+
+//-----------------------------------------------------------------------
+// REG6: Player_length register read function show()
+//-----------------------------------------------------------------------
+/**
+ * player_length_show() - Return the player_length value to user-space via
+ *                        sysfs.
+ * @dev: Device structure for the hps_led_patterns component. This
+ *       device struct is embedded in the hps_led_patterns' platform
+ *       device struct.
+ * @attr: Unused.
+ * @buf: Buffer that gets returned to user-space.
+ *
+ * Return: The number of bytes read.
+ */
+static ssize_t player_length_show(struct device *dev,
+    struct device_attribute *attr, char *buf)
+{
+    struct hps_led_patterns_dev *priv = dev_get_drvdata(dev);
+
+    u32 length = ioread32(priv->base_addr + REG6_PLAYER_LENGTH_OFFSET);
+
+    return scnprintf(buf, PAGE_SIZE, "%u\n", length);
+}
+
+//-----------------------------------------------------------------------
+// REG6: Player_length register write function store()
+//-----------------------------------------------------------------------
+/**
+ * player_length_store() - Store the player_length value.
+ * @dev: Device structure for the hps_led_patterns component. This
+ *       device struct is embedded in the hps_led_patterns' platform
+ *       device struct.
+ * @attr: Unused.
+ * @buf: Buffer that contains the number of table entries to play.
+ * @size: The number of bytes being written.
+ *
+ * Return: The number of bytes stored.
+ */
+static ssize_t player_length_store(struct device *dev,
+    struct device_attribute *attr, const char *buf, size_t size)
+{
+    struct hps_led_patterns_dev *priv = dev_get_drvdata(dev);
+
+    u32 length;
+    int ret = kstrtou32(buf, 0, &length);
+    if (ret < 0) {
+        // kstrtou32 returned an error
+        return ret;
+    }
+    if (length > PATTERN_TABLE_ENTRIES)
+        return -EINVAL;
+
+    iowrite32(length, priv->base_addr + REG6_PLAYER_LENGTH_OFFSET);
+
+    // Write was succesful, so we return the number of bytes we wrote.
+    return size;
+}
+
+
+//-----------------------------------------------------------------------
+// REG7: Player_index register read function show()
+//-----------------------------------------------------------------------
+/**
+ * player_index_show() - Return the table entry currently being played to
+ *                       user-space via sysfs.
+ * @dev: Device structure for the hps_led_patterns component. This
+ *       device struct is embedded in the hps_led_patterns' platform
+ *       device struct.
+ * @attr: Unused.
+ * @buf: Buffer that gets returned to user-space.
+ *
+ * Return: The number of bytes read.
+ */
+static ssize_t player_index_show(struct device *dev,
+    struct device_attribute *attr, char *buf)
+{
+    struct hps_led_patterns_dev *priv = dev_get_drvdata(dev);
+
+    u32 index = ioread32(priv->base_addr + REG7_PLAYER_INDEX_OFFSET);
+
+    return scnprintf(buf, PAGE_SIZE, "%u\n", index);
+}
+
+
+//-----------------------------------------------------------------------
+// Pattern table read function show()
+//-----------------------------------------------------------------------
+/**
+ * pattern_table_show() - Return the table entries selected for playback to
+ *                        user-space via sysfs.
+ * @dev: Device structure for the hps_led_patterns component. This
+ *       device struct is embedded in the hps_led_patterns' platform
+ *       device struct.
+ * @attr: Unused.
+ * @buf: Buffer that gets returned to user-space.
+ *
+ * Entries are printed one per line, as a hexadecimal LED value followed by a
+ * decimal duration in Base_rate ticks; this is the same format that
+ * pattern_table_store() accepts.
+ *
+ * Return: The number of bytes read.
+ */
+static ssize_t pattern_table_show(struct device *dev,
+    struct device_attribute *attr, char *buf)
+{
+    struct hps_led_patterns_dev *priv = dev_get_drvdata(dev);
+
+    u32 first = ioread32(priv->base_addr + REG5_PLAYER_FIRST_OFFSET);
+    u32 length = ioread32(priv->base_addr + REG6_PLAYER_LENGTH_OFFSET);
+    // Table entries hold up to the first 32 LEDs
+    int digits = DIV_ROUND_UP(min_t(u32, priv->led_width, 32), 4);
+    ssize_t len = 0;
+    u32 *words;
+
+    length = min_t(u32, length, PATTERN_TABLE_ENTRIES);
+    words = kmalloc_array(2 * PATTERN_TABLE_ENTRIES, sizeof(*words), GFP_KERNEL);
+    if (!words)
+        return -ENOMEM;
+
+    // Fetch the whole table first, so the reads go out back to back
+    pattern_table_read(priv, first, length, words);
+    for (u32 i = 0; i < length; i++)
+        len += scnprintf(buf + len, PAGE_SIZE - len, "0x%0*X %u\n", digits,
+                         words[2*i], words[2*i + 1]);
+
+    kfree(words);
+    return len;
+}
+
+//-----------------------------------------------------------------------
+// Pattern table write function store()
+//-----------------------------------------------------------------------
+/**
+ * pattern_table_store() - Upload a pattern table.
+ * @dev: Device structure for the hps_led_patterns component. This
+ *       device struct is embedded in the hps_led_patterns' platform
+ *       device struct.
+ * @attr: Unused.
+ * @buf: Buffer that contains one "LED DURATION" entry per line, with the LED
+ *       value in hexadecimal and the duration in decimal Base_rate ticks.
+ * @size: The number of bytes being written.
+ *
+ * Entries are written starting at table entry 0, and player_first and
+ * player_length are updated to cover exactly the uploaded entries. Lines that
+ * don't parse (such as blank lines) are skipped.
+ *
+ * Return: The number of bytes stored.
+ */
+static ssize_t pattern_table_store(struct device *dev,
+    struct device_attribute *attr, const char *buf, size_t size)
+{
+    struct hps_led_patterns_dev *priv = dev_get_drvdata(dev);
+
+    u32 entries;
+    u32 *words;
+
+    words = kmalloc_array(2 * PATTERN_TABLE_ENTRIES, sizeof(*words), GFP_KERNEL);
+    if (!words)
+        return -ENOMEM;
+
+    // Parse the whole table first, so the writes go out back to back
+    entries = pattern_table_parse(buf, size, words);
+
+    mutex_lock(&priv->lock);
+    pattern_table_write(priv, 0, entries, words);
+    iowrite32(0, priv->base_addr + REG5_PLAYER_FIRST_OFFSET);
+    iowrite32(entries, priv->base_addr + REG6_PLAYER_LENGTH_OFFSET);
+    mutex_unlock(&priv->lock);
+    kfree(words);
+
+    pr_debug("uploaded %u pattern table entries\n", entries);
+    // Return the number of bytes we wrote
+    return size;
+}
+
+
+//-----------------------------------------------------------------------
+// REG9: IRQ_mask register read function show()
+//-----------------------------------------------------------------------
+/**
+ * irq_mask_show() - Return the irq_mask value to user-space via sysfs.
+ * @dev: Device structure for the hps_led_patterns component. This
+ *       device struct is embedded in the hps_led_patterns' platform
+ *       device struct.
+ * @attr: Unused.
+ * @buf: Buffer that gets returned to user-space.
+ *
+ * Return: The number of bytes read.
+ */
+static ssize_t irq_mask_show(struct device *dev,
+    struct device_attribute *attr, char *buf)
+{
+    struct hps_led_patterns_dev *priv = dev_get_drvdata(dev);
+
+    u32 mask = ioread32(priv->base_addr + REG9_IRQ_MASK_OFFSET);
+
+    return scnprintf(buf, PAGE_SIZE, "0x%X\n", mask);
+}
+
+//-----------------------------------------------------------------------
+// REG9: IRQ_mask register write function store()
+//-----------------------------------------------------------------------
+/**
+ * irq_mask_store() - Select which events raise interrupts.
+ * @dev: Device structure for the hps_led_patterns component. This
+ *       device struct is embedded in the hps_led_patterns' platform
+ *       device struct.
+ * @attr: Unused.
+ * @buf: Buffer that contains the mask: any combination of 0x1 (pushbutton),
+ *       0x2 (switches), 0x4 (pattern changes) and 0x8 (write FIFO low
+ *       watermark).
+ * @size: The number of bytes being written.
+ *
+ * Return: The number of bytes stored.
+ */
+static ssize_t irq_mask_store(struct device *dev,
+    struct device_attribute *attr, const char *buf, size_t size)
+{
+    struct hps_led_patterns_dev *priv = dev_get_drvdata(dev);
+
+    u32 mask;
+    int ret;
+
+    ret = kstrtou32(buf, 0, &mask);
+    if (ret < 0) {
+        // kstrtou32 failed, so return its error code
+        return ret;
+    }
+    if (mask & ~IRQ_ALL) {
+        return -EINVAL;
+    }
+
+    mutex_lock(&priv->lock);
+    iowrite32(mask, priv->base_addr + REG9_IRQ_MASK_OFFSET);
+    mutex_unlock(&priv->lock);
+
+    // Return the number of bytes we wrote
+    return size;
+}
+
+//-----------------------------------------------------------------------
+// Pending events read function show()
+//-----------------------------------------------------------------------
+/**
+ * irq_events_show() - Return the events seen since they were last cleared.
+ * @dev: Device structure for the hps_led_patterns component. This
+ *       device struct is embedded in the hps_led_patterns' platform
+ *       device struct.
+ * @attr: Unused.
+ * @buf: Buffer that gets returned to user-space.
+ *
+ * This attribute supports poll(), and is notified whenever an interrupt
+ * arrives.
+ *
+ * Return: The number of bytes read.
+ */
+static ssize_t irq_events_show(struct device *dev,
+    struct device_attribute *attr, char *buf)
+{
+    struct hps_led_patterns_dev *priv = dev_get_drvdata(dev);
+
+    return scnprintf(buf, PAGE_SIZE, "0x%X\n", READ_ONCE(priv->events));
+}
+
+//-----------------------------------------------------------------------
+// Pending events write function store()
+//-----------------------------------------------------------------------
+/**
+ * irq_events_store() - Clear events that user-space has handled.
+ * @dev: Device structure for the hps_led_patterns component. This
+ *       device struct is embedded in the hps_led_patterns' platform
+ *       device struct.
+ * @attr: Unused.
+ * @buf: Buffer that contains the event bits to clear (write-one-to-clear).
+ * @size: The number of bytes being written.
+ *
+ * Return: The number of bytes stored.
+ */
+static ssize_t irq_events_store(struct device *dev,
+    struct device_attribute *attr, const char *buf, size_t size)
+{
+    struct hps_led_patterns_dev *priv = dev_get_drvdata(dev);
+
+    u32 clear;
+    int ret;
+
+    ret = kstrtou32(buf, 0, &clear);
+    if (ret < 0) {
+        // kstrtou32 failed, so return its error code
+        return ret;
+    }
+
+    spin_lock_irq(&priv->event_lock);
+    priv->events &= ~clear;
+    spin_unlock_irq(&priv->event_lock);
+
+    // Return the number of bytes we wrote
+    return size;
+}
+
+//-----------------------------------------------------------------------
+// REG10: IRQ_raise register write function store()
+//-----------------------------------------------------------------------
+/**
+ * irq_raise_store() - Simulate events, for testing.
+ * @dev: Device structure for the hps_led_patterns component. This
+ *       device struct is embedded in the hps_led_patterns' platform
+ *       device struct.
+ * @attr: Unused.
+ * @buf: Buffer that contains the event bits to raise, in the same format as
+ *       irq_mask.
+ * @size: The number of bytes being written.
+ *
+ * The hardware latches these exactly as if the events had really happened,
+ * so this exercises the whole interrupt path without touching the board.
+ *
+ * Return: The number of bytes stored.
+ */
+static ssize_t irq_raise_store(struct device *dev,
+    struct device_attribute *attr, const char *buf, size_t size)
+{
+    struct hps_led_patterns_dev *priv = dev_get_drvdata(dev);
+
+    u32 raise;
+    int ret;
+
+    ret = kstrtou32(buf, 0, &raise);
+    if (ret < 0) {
+        // kstrtou32 failed, so return its error code
+        return ret;
+    }
+    if (raise & ~IRQ_ALL) {
+        return -EINVAL;
+    }
+
+    mutex_lock(&priv->lock);
+    iowrite32(raise, priv->base_addr + REG10_IRQ_RAISE_OFFSET);
+    mutex_unlock(&priv->lock);
+
+    // Return the number of bytes we wrote
+    return size;
+}
+
+
+//-----------------------------------------------------------------------
+// REG13/REG14: Cycle counter read function show()
+//-----------------------------------------------------------------------
+/**
+ * cycle_count_show() - Return the hardware cycle counter to user-space via
+ *                      sysfs.
+ * @dev: Device structure for the hps_led_patterns component. This
+ *       device struct is embedded in the hps_led_patterns' platform
+ *       device struct.
+ * @attr: Unused.
+ * @buf: Buffer that gets returned to user-space.
+ *
+ * The counter runs freely at the system clock rate (see clock_freq) from
+ * reset.
+ *
+ * Return: The number of bytes read.
+ */
+static ssize_t cycle_count_show(struct device *dev,
+    struct device_attribute *attr, char *buf)
+{
+    struct hps_led_patterns_dev *priv = dev_get_drvdata(dev);
+
+    u64 cycles;
+
+    if (!(priv->caps & CAP_TIMESTAMPS))
+        return -ENODEV;
+
+    mutex_lock(&priv->lock);
+    cycles = read_latched64(priv, REG13_COUNTER_LO_OFFSET);
+    mutex_unlock(&priv->lock);
+
+    return scnprintf(buf, PAGE_SIZE, "%llu\n", cycles);
+}
+
+//-----------------------------------------------------------------------
+// REG15: Clock_freq register read function show()
+//-----------------------------------------------------------------------
+/**
+ * clock_freq_show() - Return the cycle counter's rate to user-space via sysfs.
+ * @dev: Device structure for the hps_led_patterns component. This
+ *       device struct is embedded in the hps_led_patterns' platform
+ *       device struct.
+ * @attr: Unused.
+ * @buf: Buffer that gets returned to user-space.
+ *
+ * Return: The number of bytes read.
+ */
+static ssize_t clock_freq_show(struct device *dev,
+    struct device_attribute *attr, char *buf)
+{
+    struct hps_led_patterns_dev *priv = dev_get_drvdata(dev);
+
+    if (!(priv->caps & CAP_TIMESTAMPS))
+        return -ENODEV;
+
+    return scnprintf(buf, PAGE_SIZE, "%u\n",
+                     ioread32(priv->base_addr + REG15_CLOCK_FREQ_OFFSET));
+}
+
+//-----------------------------------------------------------------------
+// Write timestamp read function show()
+//-----------------------------------------------------------------------
+/**
+ * write_timestamps_show() - Return the cycle count of the last write to each
+ *                           register to user-space via sysfs.
+ * @dev: Device structure for the hps_led_patterns component. This
+ *       device struct is embedded in the hps_led_patterns' platform
+ *       device struct.
+ * @attr: Unused.
+ * @buf: Buffer that gets returned to user-space.
+ *
+ * Registers are printed one per line, as a register (word) number followed by
+ * the cycle count at which it was last written, or 0 if it never was. Writes
+ * to the LED window count as writes to LED_reg (register 1). Comparing these
+ * against cycle_count or clock_sync gives the end-to-end latency of a write.
+ *
+ * Return: The number of bytes read.
+ */
+static ssize_t write_timestamps_show(struct device *dev,
+    struct device_attribute *attr, char *buf)
+{
+    struct hps_led_patterns_dev *priv = dev_get_drvdata(dev);
+
+    u64 stamps[WRITE_STAMP_REGS];
+    ssize_t len = 0;
+
+    if (!(priv->caps & CAP_TIMESTAMPS))
+        return -ENODEV;
+
+    mutex_lock(&priv->lock);
+    for (u32 i = 0; i < WRITE_STAMP_REGS; i++)
+        stamps[i] = read_latched64(priv, WRITE_STAMP_LO_OFFSET(i));
+    mutex_unlock(&priv->lock);
+
+    for (u32 i = 0; i < WRITE_STAMP_REGS; i++)
+        len += scnprintf(buf + len, PAGE_SIZE - len, "%u %llu\n", i, stamps[i]);
+
+    return len;
+}
+
+//-----------------------------------------------------------------------
+// Clock calibration read function show()
+//-----------------------------------------------------------------------
+/**
+ * clock_sync_show() - Return a paired hardware cycle count and kernel
+ *                     timestamp to user-space via sysfs.
+ * @dev: Device structure for the hps_led_patterns component. This
+ *       device struct is embedded in the hps_led_patterns' platform
+ *       device struct.
+ * @attr: Unused.
+ * @buf: Buffer that gets returned to user-space.
+ *
+ * Prints the cycle count, the CLOCK_MONOTONIC time (in nanoseconds) halfway
+ * through reading it, and the uncertainty of that pairing (half the time the
+ * read took, also in nanoseconds). Two samples some time apart give the
+ * hardware clock's rate and offset relative to the kernel's.
+ *
+ * Return: The number of bytes read.
+ */
+static ssize_t clock_sync_show(struct device *dev,
+    struct device_attribute *attr, char *buf)
+{
+    struct hps_led_patterns_dev *priv = dev_get_drvdata(dev);
+
+    u64 before, after, cycles;
+
+    if (!(priv->caps & CAP_TIMESTAMPS))
+        return -ENODEV;
+
+    mutex_lock(&priv->lock);
+    before = ktime_get_ns();
+    cycles = read_latched64(priv, REG13_COUNTER_LO_OFFSET);
+    after = ktime_get_ns();
+    mutex_unlock(&priv->lock);
+
+    return scnprintf(buf, PAGE_SIZE, "%llu %llu %llu\n", cycles,
+                     before + (after - before) / 2, (after - before) / 2);
+}
+
+
+//-----------------------------------------------------------------------
+// REG16: FIFO_control register read function show()
+//-----------------------------------------------------------------------
+/**
+ * fifo_run_show() - Return whether the write FIFO is draining to user-space
+ *                   via sysfs.
+ * @dev: Device structure for the hps_led_patterns component. This
+ *       device struct is embedded in the hps_led_patterns' platform
+ *       device struct.
+ * @attr: Unused.
+ * @buf: Buffer that gets returned to user-space.
+ *
+ * Return: The number of bytes read.
+ */
+static ssize_t fifo_run_show(struct device *dev,
+    struct device_attribute *attr, char *buf)
+{
+    struct hps_led_patterns_dev *priv = dev_get_drvdata(dev);
+
+    u32 control;
+
+    if (!priv->fifo_depth)
+        return -ENODEV;
+
+    control = ioread32(priv->base_addr + REG16_FIFO_CONTROL_OFFSET);
+
+    return scnprintf(buf, PAGE_SIZE, "%u\n", control & FIFO_CONTROL_RUN);
+}
+
+//-----------------------------------------------------------------------
+// REG16: FIFO_control register write function store()
+//-----------------------------------------------------------------------
+/**
+ * fifo_run_store() - Start or stop draining the write FIFO.
+ * @dev: Device structure for the hps_led_patterns component. This
+ *       device struct is embedded in the hps_led_patterns' platform
+ *       device struct.
+ * @attr: Unused.
+ * @buf: Buffer that contains a boolean; true starts the write FIFO, and
+ *       false stops it. Entries then only reach the LEDs while
+ *       hps_led_control is set.
+ * @size: The number of bytes being written.
+ *
+ * Return: The number of bytes stored.
+ */
+static ssize_t fifo_run_store(struct device *dev,
+    struct device_attribute *attr, const char *buf, size_t size)
+{
+    struct hps_led_patterns_dev *priv = dev_get_drvdata(dev);
+
+    bool run;
+    int ret;
+
+    if (!priv->fifo_depth)
+        return -ENODEV;
+
+    ret = kstrtobool(buf, &run);
+    if (ret < 0) {
+        // kstrtobool returned an error
+        return ret;
+    }
+
+    mutex_lock(&priv->lock);
+    iowrite32(run ? FIFO_CONTROL_RUN : 0,
+        priv->base_addr + REG16_FIFO_CONTROL_OFFSET);
+    mutex_unlock(&priv->lock);
+
+    // Write was succesful, so we return the number of bytes we wrote.
+    return size;
+}
+
+//-----------------------------------------------------------------------
+// REG16: FIFO_control flush write function store()
+//-----------------------------------------------------------------------
+/**
+ * fifo_flush_store() - Discard every queued write FIFO entry.
+ * @dev: Device structure for the hps_led_patterns component. This
+ *       device struct is embedded in the hps_led_patterns' platform
+ *       device struct.
+ * @attr: Unused.
+ * @buf: Buffer that contains a boolean; true flushes the FIFO.
+ * @size: The number of bytes being written.
+ *
+ * The FIFO keeps running (or not) as before, and the LEDs keep the last
+ * entry shown.
+ *
+ * Return: The number of bytes stored.
+ */
+static ssize_t fifo_flush_store(struct device *dev,
+    struct device_attribute *attr, const char *buf, size_t size)
+{
+    struct hps_led_patterns_dev *priv = dev_get_drvdata(dev);
+
+    bool flush;
+    int ret;
+    u32 control;
+
+    if (!priv->fifo_depth)
+        return -ENODEV;
+
+    ret = kstrtobool(buf, &flush);
+    if (ret < 0) {
+        // kstrtobool returned an error
+        return ret;
+    }
+
+    if (flush) {
+        // Single-word char device writes of FIFO_control skip the mutex,
+        // so hold reg_lock too, lest one land between the read and the
+        // write and be undone
+        mutex_lock(&priv->lock);
+        spin_lock(&priv->reg_lock);
+        control = ioread32(priv->base_addr + REG16_FIFO_CONTROL_OFFSET);
+        iowrite32((control & FIFO_CONTROL_RUN) | FIFO_CONTROL_FLUSH,
+            priv->base_addr + REG16_FIFO_CONTROL_OFFSET);
+        spin_unlock(&priv->reg_lock);
+        mutex_unlock(&priv->lock);
+    }
+
+    // Return the number of bytes we wrote
+    return size;
+}
+
+//-----------------------------------------------------------------------
+// REG17: FIFO_level register read function show()
+//-----------------------------------------------------------------------
+/**
+ * fifo_level_show() - Return the number of queued write FIFO entries to
+ *                     user-space via sysfs.
+ * @dev: Device structure for the hps_led_patterns component. This
+ *       device struct is embedded in the hps_led_patterns' platform
+ *       device struct.
+ * @attr: Unused.
+ * @buf: Buffer that gets returned to user-space.
+ *
+ * Return: The number of bytes read.
+ */
+static ssize_t fifo_level_show(struct device *dev,
+    struct device_attribute *attr, char *buf)
+{
+    struct hps_led_patterns_dev *priv = dev_get_drvdata(dev);
+
+    if (!priv->fifo_depth)
+        return -ENODEV;
+
+    return scnprintf(buf, PAGE_SIZE, "%u\n",
+                     ioread32(priv->base_addr + REG17_FIFO_LEVEL_OFFSET));
+}
+
+//-----------------------------------------------------------------------
+// REG18: FIFO_status register read function show()
+//-----------------------------------------------------------------------
+/**
+ * fifo_status_show() - Return the write FIFO status bits to user-space via
+ *                      sysfs.
+ * @dev: Device structure for the hps_led_patterns component. This
+ *       device struct is embedded in the hps_led_patterns' platform
+ *       device struct.
+ * @attr: Unused.
+ * @buf: Buffer that gets returned to user-space.
+ *
+ * Bits are as in reg_offsets.h: 0x1 empty, 0x2 at or below the low
+ * watermark, 0x4 full, 0x8 underflowed and 0x10 overflowed.
+ *
+ * Return: The number of bytes read.
+ */
+static ssize_t fifo_status_show(struct device *dev,
+    struct device_attribute *attr, char *buf)
+{
+    struct hps_led_patterns_dev *priv = dev_get_drvdata(dev);
+
+    if (!priv->fifo_depth)
+        return -ENODEV;
+
+    return scnprintf(buf, PAGE_SIZE, "0x%X\n",
+                     ioread32(priv->base_addr + REG18_FIFO_STATUS_OFFSET));
+}
+
+//-----------------------------------------------------------------------
+// REG18: FIFO_status register write function store()
+//-----------------------------------------------------------------------
+/**
+ * fifo_status_store() - Clear sticky write FIFO status bits.
+ * @dev: Device structure for the hps_led_patterns component. This
+ *       device struct is embedded in the hps_led_patterns' platform
+ *       device struct.
+ * @attr: Unused.
+ * @buf: Buffer that contains the underflow and/or overflow bits to clear
+ *       (write-one-to-clear).
+ * @size: The number of bytes being written.
+ *
+ * Return: The number of bytes stored.
+ */
+static ssize_t fifo_status_store(struct device *dev,
+    struct device_attribute *attr, const char *buf, size_t size)
+{
+    struct hps_led_patterns_dev *priv = dev_get_drvdata(dev);
+
+    u32 clear;
+    int ret;
+
+    if (!priv->fifo_depth)
+        return -ENODEV;
+
+    ret = kstrtou32(buf, 0, &clear);
+    if (ret < 0) {
+        // kstrtou32 failed, so return its error code
+        return ret;
+    }
+    if (clear & ~(FIFO_STATUS_UNDERFLOW | FIFO_STATUS_OVERFLOW)) {
+        return -EINVAL;
+    }
+
+    mutex_lock(&priv->lock);
+    iowrite32(clear, priv->base_addr + REG18_FIFO_STATUS_OFFSET);
+    mutex_unlock(&priv->lock);
+
+    // Return the number of bytes we wrote
+    return size;
+}
+
+//-----------------------------------------------------------------------
+// REG19: FIFO_watermark register read function show()
+//-----------------------------------------------------------------------
+/**
+ * fifo_watermark_show() - Return the write FIFO low watermark to user-space
+ *                         via sysfs.
+ * @dev: Device structure for the hps_led_patterns component. This
+ *       device struct is embedded in the hps_led_patterns' platform
+ *       device struct.
+ * @attr: Unused.
+ * @buf: Buffer that gets returned to user-space.
+ *
+ * Return: The number of bytes read.
+ */
+static ssize_t fifo_watermark_show(struct device *dev,
+    struct device_attribute *attr, char *buf)
+{
+    struct hps_led_patterns_dev *priv = dev_get_drvdata(dev);
+
+    if (!priv->fifo_depth)
+        return -ENODEV;
+
+    return scnprintf(buf, PAGE_SIZE, "%u\n",
+                     ioread32(priv->base_addr + REG19_FIFO_WATERMARK_OFFSET));
+}
+
+//-----------------------------------------------------------------------
+// REG19: FIFO_watermark register write function store()
+//-----------------------------------------------------------------------
+/**
+ * fifo_watermark_store() - Set the write FIFO low watermark.
+ * @dev: Device structure for the hps_led_patterns component. This
+ *       device struct is embedded in the hps_led_patterns' platform
+ *       device struct.
+ * @attr: Unused.
+ * @buf: Buffer that contains the watermark, in entries.
+ * @size: The number of bytes being written.
+ *
+ * Whenever the FIFO drains to this many entries or fewer, the low watermark
+ * event (IRQ_FIFO) is raised, so a writer can sleep in poll() until it is
+ * time to refill.
+ *
+ * Return: The number of bytes stored.
+ */
+static ssize_t fifo_watermark_store(struct device *dev,
+    struct device_attribute *attr, const char *buf, size_t size)
+{
+    struct hps_led_patterns_dev *priv = dev_get_drvdata(dev);
+
+    u32 watermark;
+    int ret;
+
+    if (!priv->fifo_depth)
+        return -ENODEV;
+
+    ret = kstrtou32(buf, 0, &watermark);
+    if (ret < 0) {
+        // kstrtou32 failed, so return its error code
+        return ret;
+    }
+    if (watermark > priv->fifo_depth) {
+        return -EINVAL;
+    }
+
+    mutex_lock(&priv->lock);
+    iowrite32(watermark, priv->base_addr + REG19_FIFO_WATERMARK_OFFSET);
+    mutex_unlock(&priv->lock);
+
+    // Return the number of bytes we wrote
+    return size;
+}
+
+//-----------------------------------------------------------------------
+// REG20: FIFO_depth register read function show()
+//-----------------------------------------------------------------------
+/**
+ * fifo_depth_show() - Return the write FIFO's capacity to user-space via
+ *                     sysfs.
+ * @dev: Device structure for the hps_led_patterns component. This
+ *       device struct is embedded in the hps_led_patterns' platform
+ *       device struct.
+ * @attr: Unused.
+ * @buf: Buffer that gets returned to user-space.
+ *
+ * Return: The number of bytes read.
+ */
+static ssize_t fifo_depth_show(struct device *dev,
+    struct device_attribute *attr, char *buf)
+{
+    struct hps_led_patterns_dev *priv = dev_get_drvdata(dev);
+
+    return scnprintf(buf, PAGE_SIZE, "%u\n", priv->fifo_depth);
+}
+
+//-----------------------------------------------------------------------
+// Write FIFO push function store()
+//-----------------------------------------------------------------------
+/**
+ * fifo_entries_store() - Push entries onto the write FIFO.
+ * @dev: Device structure for the hps_led_patterns component. This
+ *       device struct is embedded in the hps_led_patterns' platform
+ *       device struct.
+ * @attr: Unused.
+ * @buf: Buffer that contains the entries, one per line, as a hexadecimal LED
+ *       value followed by a decimal hold time in clock cycles.
+ * @size: The number of bytes being written.
+ *
+ * Entries are pushed all at once, or not at all: if they don't all fit, this
+ * fails with -EAGAIN, and the caller should wait for the low watermark
+ * event before retrying. The char device's push window offers the same in
+ * binary form, pushing as many entries as fit.
+ *
+ * Return: The number of bytes stored.
+ */
+static ssize_t fifo_entries_store(struct device *dev,
+    struct device_attribute *attr, const char *buf, size_t size)
+{
+    struct hps_led_patterns_dev *priv = dev_get_drvdata(dev);
+
+    const char *line = buf;
+    const char *end = buf + size;
+    u32 entries = 0;
+    ssize_t ret = size;
+    u32 *words;
+
+    if (!priv->fifo_depth)
+        return -ENODEV;
+
+    words = kmalloc_array(2 * priv->fifo_depth, sizeof(*words), GFP_KERNEL);
+    if (!words)
+        return -ENOMEM;
+
+    // Parse every entry first, so the writes go out back to back
+    while (line < end) {
+        const char *next = memchr(line, '\n', end - line);
+        size_t len = (next ? next : end) - line;
+        char entry_buf[32];
+        unsigned int led, hold;
+        // Parse each line on its own, so sscanf() can't run across lines
+        if (len >= sizeof(entry_buf)) {
+            line = next ? next + 1 : end;
+            continue;
+        }
+        memcpy(entry_buf, line, len);
+        entry_buf[len] = '\0';
+        if (sscanf(entry_buf, "%x %u", &led, &hold) == 2) {
+            if (entries == priv->fifo_depth) {
+                // More than could ever fit
+                ret = -EFBIG;
+                goto free;
+            }
+            words[2*entries] = led;
+            words[2*entries + 1] = hold;
+            entries++;
+        }
+        line = next ? next + 1 : end;
+    }
+
+    mutex_lock(&priv->lock);
+    if (fifo_room(priv) < entries)
+        ret = -EAGAIN;
+    else
+        fifo_push(priv, entries, words);
+    mutex_unlock(&priv->lock);
+
+free:
+    kfree(words);
+    return ret;
+}
+
+
+//-----------------------------------------------------------------------
+// REG21: Pattern_select register read function show()
+//-----------------------------------------------------------------------
+// Built-in pattern names, indexed by pattern number
+static const char * const pattern_names[PATTERN_COUNT] = {
+    [PATTERN_SWITCH] = "switch",
+    [PATTERN_SHIFT_RIGHT] = "shift_right",
+    [PATTERN_SHIFT_LEFT] = "shift_left",
+    [PATTERN_COUNT_UP] = "count_up",
+    [PATTERN_COUNT_DOWN] = "count_down",
+    [PATTERN_CUSTOM] = "custom",
+};
+
+/**
+ * pattern_show() - Return the built-in pattern currently selected to
+ *                  user-space via sysfs.
+ * @dev: Device structure for the hps_led_patterns component. This
+ *       device struct is embedded in the hps_led_patterns' platform
+ *       device struct.
+ * @attr: Unused.
+ * @buf: Buffer that gets returned to user-space.
+ *
+ * Return: The number of bytes read.
+ */
+static ssize_t pattern_show(struct device *dev,
+    struct device_attribute *attr, char *buf)
+{
+    struct hps_led_patterns_dev *priv = dev_get_drvdata(dev);
+
+    u32 pattern = EVENT_STATE_PATTERN(
+        ioread32(priv->base_addr + REG11_EVENT_STATE_OFFSET));
+
+    if (pattern >= PATTERN_COUNT)
+        return scnprintf(buf, PAGE_SIZE, "%u\n", pattern);
+    return scnprintf(buf, PAGE_SIZE, "%s\n", pattern_names[pattern]);
+}
+
 //-----------------------------------------------------------------------
-// HPS_LED_Patterns device structure
+// REG21: Pattern_select register write function store()
 //-----------------------------------------------------------------------
 /**
- * struct  hps_led_patterns_dev - Private hps_led_patterns device struct.
- * @miscdev: miscdevice used to create a char device for the hps_led_patterns
- *           component
- * @base_addr: Base address of the hps_led_patterns component
- * @lock: mutex used to prevent concurrent writes to the hps_led_patterns
- *        component
+ * pattern_store() - Select a built-in pattern, as if by the switches.
+ * @dev: Device structure for the hps_led_patterns component. This
+ *       device struct is embedded in the hps_led_patterns' platform
+ *       device struct.
+ * @attr: Unused.
+ * @buf: Buffer that contains a pattern name (as shown by pattern_show()) or
+ *       number; "switch" (0) acts like a press of the pushbutton.
+ * @size: The number of bytes being written.
  *
- * An hps_led_patterns_dev struct gets created for each hps_led_patterns
- * component in the system.
+ * The pattern runs at its usual multiple of base_rate, and shows on the LEDs
+ * unless hps_led_control is set or the pattern player is running.
+ *
+ * Return: The number of bytes stored.
  */
-struct hps_led_patterns_dev {
-    struct miscdevice miscdev;
-    void __iomem *base_addr;
-    struct mutex lock;
-};
+static ssize_t pattern_store(struct device *dev,
+    struct device_attribute *attr, const char *buf, size_t size)
+{
+    struct hps_led_patterns_dev *priv = dev_get_drvdata(dev);
+
+    u32 pattern;
+    int ret;
+
+    if (!(priv->caps & CAP_PATTERN_SELECT))
+        return -ENODEV;
+
+    ret = sysfs_match_string(pattern_names, buf);
+    if (ret >= 0) {
+        pattern = ret;
+    } else {
+        ret = kstrtou32(buf, 0, &pattern);
+        if (ret < 0) {
+            // Neither a name nor a number
+            return -EINVAL;
+        }
+        if (pattern >= PATTERN_COUNT) {
+            return -EINVAL;
+        }
+    }
+
+    mutex_lock(&priv->lock);
+    iowrite32(pattern, priv->base_addr + REG21_PATTERN_SELECT_OFFSET);
+    mutex_unlock(&priv->lock);
+
+    // Return the number of bytes we wrote
+    return size;
+}
 
 
 //-----------------------------------------------------------------------
-// REG0: HPS_LED_control register read function show()
+// PWM brightness read function show()
 //-----------------------------------------------------------------------
 /**
- * hps_led_control_show() - Return the hps_led_control value to user-space via
- *                          sysfs.
- * @dev: Device structure for the hps_led_patterns component. This device
- *       struct is embedded in the hps_led_patterns' device struct.
+ * brightness_show() - Return the brightness of each LED to user-space via
+ *                     sysfs.
+ * @dev: Device structure for the hps_led_patterns component. This
+ *       device struct is embedded in the hps_led_patterns' platform
+ *       device struct.
  * @attr: Unused.
  * @buf: Buffer that gets returned to user-space.
  *
+ * Brightnesses are printed in decimal, LED 0 first, separated by spaces.
+ * Each takes up to four bytes, so only as many LEDs are printed as are sure
+ * to fit in a page (1023 with 4 KiB pages); read any past them through the
+ * char device.
+ *
  * Return: The number of bytes read.
  */
-static ssize_t hps_led_control_show(struct device *dev,
+static ssize_t brightness_show(struct device *dev,
     struct device_attribute *attr, char *buf)
 {
-    // Get the private hps_led_patterns data out of the dev struct
     struct hps_led_patterns_dev *priv = dev_get_drvdata(dev);
 
-    bool hps_control = ioread32(priv->base_addr + REG0_HPS_LED_CONTROL_OFFSET);
+    ssize_t len = 0;
+    u32 shown;
+    u32 *words;
 
-    return scnprintf(buf, PAGE_SIZE, "%u\n", hps_control);
+    if (!priv->pwm_width)
+        return -ENODEV;
+    shown = min_t(u32, priv->pwm_width, (PAGE_SIZE - 1) / 4);
+    words = kmalloc_array(DIV_ROUND_UP(priv->pwm_width, 4), sizeof(*words), GFP_KERNEL);
+    if (!words)
+        return -ENOMEM;
+
+    // Fetch every word first, so the reads go out back to back
+    mutex_lock(&priv->lock);
+    for (u32 i = 0; i < DIV_ROUND_UP(priv->pwm_width, 4); i++)
+        words[i] = readl_relaxed(priv->base_addr + BRIGHTNESS_WORD_OFFSET(4 * i));
+    rmb();
+    mutex_unlock(&priv->lock);
+
+    for (u32 i = 0; i < shown; i++)
+        len += scnprintf(buf + len, PAGE_SIZE - len, "%u%c",
+                         (words[i / 4] >> (8 * (i % 4))) & 0xFF,
+                         (i == shown - 1) ? '\n' : ' ');
+
+    kfree(words);
+    return len;
 }
 
 //-----------------------------------------------------------------------
-// REG0: HPS_LED_control register write function store()
+// PWM brightness write function store()
 //-----------------------------------------------------------------------
 /**
- * hps_led_control_store() - Store the hps_led_control value.
- * @dev: Device structure for the hps_led_patterns component. This device
- *       struct is embedded in the hps_led_patterns' platform device struct.
+ * brightness_store() - Set the brightness of each LED.
+ * @dev: Device structure for the hps_led_patterns component. This
+ *       device struct is embedded in the hps_led_patterns' platform
+ *       device struct.
  * @attr: Unused.
- * @buf: Buffer that contains the hps_led_control value being written.
+ * @buf: Buffer that contains brightnesses (0 to 255) separated by spaces,
+ *       starting from LED 0; any LEDs not given keep their brightness.
  * @size: The number of bytes being written.
  *
+ * Each brightness is mapped through the gamma table to a duty cycle, which
+ * dims the LED whenever it is on, whatever is driving it. Each four LEDs take
+ * one bus write, and any left over one byte write each.
+ *
  * Return: The number of bytes stored.
  */
-static ssize_t hps_led_control_store(struct device *dev,
+static ssize_t brightness_store(struct device *dev,
     struct device_attribute *attr, const char *buf, size_t size)
 {
     struct hps_led_patterns_dev *priv = dev_get_drvdata(dev);
 
-    // Parse the string we received as a bool
-    // See https://elixir.bootlin.com/linux/latest/source/lib/kstrtox.c#L289
-    bool hps_control;
-    int ret = kstrtobool(buf, &hps_control);
-    if (ret < 0) {
-        // kstrtobool returned an error
-        return ret;
+    u8 *vals;
+    int count;
+    int i;
+
+    if (!priv->pwm_width)
+        return -ENODEV;
+    vals = kmalloc(priv->pwm_width, GFP_KERNEL);
+    if (!vals)
+        return -ENOMEM;
+
+    count = str2bytes(buf, size, vals, priv->pwm_width);
+    if (count < 0) {
+        // Parsing failed, so return its error code
+        kfree(vals);
+        return count;
     }
 
-    iowrite32(hps_control, priv->base_addr + REG0_HPS_LED_CONTROL_OFFSET);
+    mutex_lock(&priv->lock);
+    for (i = 0; i + 4 <= count; i += 4)
+        writel_relaxed(vals[i] | vals[i + 1] << 8 | vals[i + 2] << 16 | (u32)vals[i + 3] << 24,
+                       priv->base_addr + BRIGHTNESS_WORD_OFFSET(i));
+    for (; i < count; i++)
+        writeb_relaxed(vals[i], priv->base_addr + BRIGHTNESS_WORD_OFFSET(i) + i % 4);
+    wmb();
+    mutex_unlock(&priv->lock);
+    kfree(vals);
 
-    // Write was succesful, so we return the number of bytes we wrote.
+    // Return the number of bytes we wrote
     return size;
 }
 
 
 //-----------------------------------------------------------------------
-// REG1: LED_reg register read function show()
+// Gamma table read function show()
 //-----------------------------------------------------------------------
 /**
- * led_reg_show() - Return the led_reg value to user-space via sysfs.
+ * gamma_table_show() - Return the gamma table to user-space via sysfs.
  * @dev: Device structure for the hps_led_patterns component. This
  *       device struct is embedded in the hps_led_patterns' platform
  *       device struct.
  * @attr: Unused.
  * @buf: Buffer that gets returned to user-space.
  *
+ * Entries are printed in decimal, 16 per line, in the format that
+ * gamma_table_store() accepts.
+ *
  * Return: The number of bytes read.
  */
-static ssize_t led_reg_show(struct device *dev,
+static ssize_t gamma_table_show(struct device *dev,
     struct device_attribute *attr, char *buf)
 {
     struct hps_led_patterns_dev *priv = dev_get_drvdata(dev);
 
-    u8 led_reg = ioread32(priv->base_addr + REG1_LED_REG_OFFSET);
+    ssize_t len = 0;
+    u32 *entries;
+
+    if (!priv->pwm_width)
+        return -ENODEV;
+    entries = kmalloc_array(GAMMA_TABLE_ENTRIES, sizeof(*entries), GFP_KERNEL);
+    if (!entries)
+        return -ENOMEM;
+
+    // Fetch the whole table first, so the reads go out back to back
+    mutex_lock(&priv->lock);
+    for (u32 i = 0; i < GAMMA_TABLE_ENTRIES; i++)
+        entries[i] = readl_relaxed(priv->base_addr + GAMMA_ENTRY_OFFSET(i));
+    rmb();
+    mutex_unlock(&priv->lock);
 
-    return scnprintf(buf, PAGE_SIZE, "0x%X\n", led_reg);
+    for (u32 i = 0; i < GAMMA_TABLE_ENTRIES; i++)
+        len += scnprintf(buf + len, PAGE_SIZE - len, "%u%c", entries[i],
+                         (i % 16 == 15) ? '\n' : ' ');
+
+    kfree(entries);
+    return len;
 }
 
 //-----------------------------------------------------------------------
-// REG1: LED_reg register write function store()
+// Gamma table write function store()
 //-----------------------------------------------------------------------
 /**
- * led_reg_store() - Store the led_reg value.
+ * gamma_table_store() - Upload a gamma table.
  * @dev: Device structure for the hps_led_patterns component. This
  *       device struct is embedded in the hps_led_patterns' platform
  *       device struct.
  * @attr: Unused.
- * @buf: Buffer that contains the  hps_led_patterns value being written.
+ * @buf: Buffer that contains duty cycles (0 to 255, where 255 is always on)
+ *       separated by whitespace, for brightness 0 upwards; any entries not
+ *       given are left alone.
  * @size: The number of bytes being written.
  *
+ * The hardware starts out with a gamma of 2.2; writing 0 to 255 in order
+ * makes duty cycles follow brightness linearly.
+ *
  * Return: The number of bytes stored.
  */
-static ssize_t led_reg_store(struct device *dev,
+static ssize_t gamma_table_store(struct device *dev,
     struct device_attribute *attr, const char *buf, size_t size)
 {
     struct hps_led_patterns_dev *priv = dev_get_drvdata(dev);
 
-    // Parse the string we received as a u8
-    // See https://elixir.bootlin.com/linux/latest/source/lib/kstrtox.c#L289
-    u8 led_reg;
-    int ret = kstrtou8(buf, 0, &led_reg);
-    if (ret < 0) {
-        // kstrtou16 returned an error
-        return ret;
-    }
+    u8 vals[GAMMA_TABLE_ENTRIES];
+    int count;
 
-    iowrite32(led_reg, priv->base_addr + REG1_LED_REG_OFFSET);
+    if (!priv->pwm_width)
+        return -ENODEV;
 
-    // Write was succesful, so we return the number of bytes we wrote.
+    count = str2bytes(buf, size, vals, GAMMA_TABLE_ENTRIES);
+    if (count < 0)
+        return count;
+
+    mutex_lock(&priv->lock);
+    for (int i = 0; i < count; i++)
+        writel_relaxed(vals[i], priv->base_addr + GAMMA_ENTRY_OFFSET(i));
+    wmb();
+    mutex_unlock(&priv->lock);
+
+    // Return the number of bytes we wrote
     return size;
 }
 
 
 //-----------------------------------------------------------------------
-// REG2: Base_rate register read function show()
+// Pattern firmware loading
 //-----------------------------------------------------------------------
 /**
- * base_rate_show() - Return the led_reg value to user-space via sysfs.
+ * pattern_firmware_play() - Upload a pattern table from firmware, and play it.
+ * @priv: hps_led_patterns device to write to.
+ * @name: Name of the firmware file, for logging.
+ * @fw: Firmware holding the table, in the format pattern_table_store()
+ *      accepts (and pattern_table_show() prints), optionally with a
+ *      "base_rate SECONDS" line setting the rate it plays at.
+ *
+ * The table is written from entry 0, and the player restarted on it, keeping
+ * its loop setting.
+ *
+ * Return: 0 on success, -EINVAL if the firmware holds no entries, or -ENOMEM.
+ */
+static int pattern_firmware_play(struct hps_led_patterns_dev *priv,
+    const char *name, const struct firmware *fw)
+{
+    const char *data = (const char *)fw->data;
+    const char *line = data;
+    const char *end = data + fw->size;
+    int base_rate = -1;
+    u32 entries;
+    u32 *words;
+
+    // Look for a base rate, which the table parser skips over
+    while (line < end) {
+        const char *next = memchr(line, '\n', end - line);
+        size_t len = (next ? next : end) - line;
+        if (len > 10 && strncmp(line, "base_rate ", 10) == 0)
+            base_rate = str2UQ44(line + 10, len - 10);
+        line = next ? next + 1 : end;
+    }
+
+    words = kmalloc_array(2 * PATTERN_TABLE_ENTRIES, sizeof(*words), GFP_KERNEL);
+    if (!words)
+        return -ENOMEM;
+    entries = pattern_table_parse(data, fw->size, words);
+    if (entries == 0) {
+        kfree(words);
+        return -EINVAL;
+    }
+
+    mutex_lock(&priv->lock);
+    iowrite32(PLAYER_CONTROL_STOP, priv->base_addr + REG3_PLAYER_CONTROL_OFFSET);
+    if (base_rate >= 0)
+        iowrite32(base_rate, priv->base_addr + REG2_BASE_RATE_OFFSET);
+    pattern_table_write(priv, 0, entries, words);
+    iowrite32(0, priv->base_addr + REG5_PLAYER_FIRST_OFFSET);
+    iowrite32(entries, priv->base_addr + REG6_PLAYER_LENGTH_OFFSET);
+    iowrite32(PLAYER_CONTROL_START, priv->base_addr + REG3_PLAYER_CONTROL_OFFSET);
+    mutex_unlock(&priv->lock);
+    kfree(words);
+
+    pr_info("playing %u pattern table entries from %s\n", entries, name);
+    return 0;
+}
+
+/**
+ * pattern_firmware_loaded() - Play the pattern firmware requested at probe.
+ * @fw: The firmware, or NULL if it couldn't be found.
+ * @context: The hps_led_patterns device it was requested for.
+ *
+ * Called by the firmware loader once the request made at probe completes.
+ * Without the firmware, the hardware keeps showing its built-in patterns.
+ */
+static void pattern_firmware_loaded(const struct firmware *fw, void *context)
+{
+    struct hps_led_patterns_dev *priv = context;
+    int ret;
+
+    mutex_lock(&priv->fw_lock);
+    if (!fw) {
+        pr_info("no pattern firmware %s; showing the built-in patterns\n", priv->fw_name);
+    } else {
+        ret = pattern_firmware_play(priv, priv->fw_name, fw);
+        if (ret < 0)
+            pr_warn("Failed to play pattern firmware %s: %d\n", priv->fw_name, ret);
+    }
+    mutex_unlock(&priv->fw_lock);
+    release_firmware(fw);
+    complete(&priv->fw_done);
+}
+
+//-----------------------------------------------------------------------
+// Pattern firmware read function show()
+//-----------------------------------------------------------------------
+/**
+ * pattern_firmware_show() - Return the pattern firmware file name to
+ *                           user-space via sysfs.
  * @dev: Device structure for the hps_led_patterns component. This
  *       device struct is embedded in the hps_led_patterns' platform
  *       device struct.
@@ -228,45 +2210,74 @@ static ssize_t led_reg_store(struct device *dev,
  *
  * Return: The number of bytes read.
  */
-static ssize_t base_rate_show(struct device *dev,
+static ssize_t pattern_firmware_show(struct device *dev,
     struct device_attribute *attr, char *buf)
 {
     struct hps_led_patterns_dev *priv = dev_get_drvdata(dev);
 
-    u8 base_rate = ioread32(priv->base_addr + REG2_BASE_RATE_OFFSET);
-    // Break the register into its integer and fractional parts
-    unsigned int ipart = base_rate >> 4;
-    unsigned int fpart = (base_rate & 0x0F) * 625;
+    ssize_t len;
 
-    return scnprintf(buf, PAGE_SIZE, "%u.%04u\t0x%X\n", ipart, fpart, base_rate);
+    mutex_lock(&priv->fw_lock);
+    len = scnprintf(buf, PAGE_SIZE, "%s\n", priv->fw_name);
+    mutex_unlock(&priv->fw_lock);
+
+    return len;
 }
 
 //-----------------------------------------------------------------------
-// REG2: Base_rate register write function store()
+// Pattern firmware write function store()
 //-----------------------------------------------------------------------
 /**
- * base_rate_store() - Store the led_reg value.
+ * pattern_firmware_store() - Choose a pattern firmware file, and play it.
  * @dev: Device structure for the hps_led_patterns component. This
  *       device struct is embedded in the hps_led_patterns' platform
  *       device struct.
  * @attr: Unused.
- * @buf: Buffer that contains the  hps_led_patterns value being written.
+ * @buf: Buffer that contains a firmware file name, relative to the firmware
+ *       search path (usually /lib/firmware); writing the current name again
+ *       reloads it.
  * @size: The number of bytes being written.
  *
- * Return: The number of bytes stored.
+ * The file is loaded, uploaded and played before this returns. The name is
+ * only kept if that works, so a typo doesn't replace a working choice.
+ *
+ * Return: The number of bytes stored, or -ENOENT if the file can't be found,
+ *         -EINVAL if it holds no entries, or -ENAMETOOLONG.
  */
-static ssize_t base_rate_store(struct device *dev,
+static ssize_t pattern_firmware_store(struct device *dev,
     struct device_attribute *attr, const char *buf, size_t size)
 {
     struct hps_led_patterns_dev *priv = dev_get_drvdata(dev);
 
-    // Parse the string we received as a UQ4.4
-    u8 base_rate;
-    base_rate = str2UQ44(buf, size);
+    char name[PATTERN_FIRMWARE_NAME_MAX];
+    const struct firmware *fw;
+    size_t len = size;
+    int ret;
 
-    iowrite32(base_rate, priv->base_addr + REG2_BASE_RATE_OFFSET);
-    // Return the number of bytes we wrote
-    return size;
+    // Ignore the trailing newline left by echo
+    if (len > 0 && buf[len - 1] == '\n')
+        len--;
+    if (len == 0)
+        return -EINVAL;
+    if (len >= sizeof(name))
+        return -ENAMETOOLONG;
+    memcpy(name, buf, len);
+    name[len] = '\0';
+
+    mutex_lock(&priv->fw_lock);
+    ret = request_firmware(&fw, name, dev);
+    if (ret == 0) {
+        ret = pattern_firmware_play(priv, name, fw);
+        release_firmware(fw);
+    }
+    if (ret == 0) {
+        // Only keep a name that worked
+        strscpy(priv->fw_name, name, sizeof(priv->fw_name));
+    }
+    mutex_unlock(&priv->fw_lock);
+
+    // Return the number of bytes we wrote, if all went well
+    return ret < 0 ? ret : size;
 }
 
 
@@ -276,14 +2287,66 @@ static ssize_t base_rate_store(struct device *dev,
 // Define sysfs attributes
 static DEVICE_ATTR_RW(hps_led_control);
 static DEVICE_ATTR_RW(led_reg);
+static DEVICE_ATTR_RO(led_width);
 static DEVICE_ATTR_RW(base_rate);
+static DEVICE_ATTR_RW(base_period);
+static DEVICE_ATTR_RW(player_run);
+static DEVICE_ATTR_RW(player_loop);
+static DEVICE_ATTR_RW(player_first);
+static DEVICE_ATTR_RW(player_length);
+static DEVICE_ATTR_RO(player_index);
+static DEVICE_ATTR_RW(pattern_table);
+static DEVICE_ATTR_RW(irq_mask);
+static DEVICE_ATTR_RW(irq_events);
+static DEVICE_ATTR_WO(irq_raise);
+static DEVICE_ATTR_RO(cycle_count);
+static DEVICE_ATTR_RO(clock_freq);
+static DEVICE_ATTR_RO(write_timestamps);
+static DEVICE_ATTR_RO(clock_sync);
+static DEVICE_ATTR_RW(fifo_run);
+static DEVICE_ATTR_WO(fifo_flush);
+static DEVICE_ATTR_RO(fifo_level);
+static DEVICE_ATTR_RW(fifo_status);
+static DEVICE_ATTR_RW(fifo_watermark);
+static DEVICE_ATTR_RO(fifo_depth);
+static DEVICE_ATTR_WO(fifo_entries);
+static DEVICE_ATTR_RW(pattern);
+static DEVICE_ATTR_RW(brightness);
+static DEVICE_ATTR_RW(gamma_table);
+static DEVICE_ATTR_RW(pattern_firmware);
 
 // Create an attribute group so the device core can export the attributes for
 // us.
 static struct attribute *hps_led_patterns_attrs[] = {
     &dev_attr_hps_led_control.attr,
     &dev_attr_led_reg.attr,
+    &dev_attr_led_width.attr,
     &dev_attr_base_rate.attr,
+    &dev_attr_base_period.attr,
+    &dev_attr_player_run.attr,
+    &dev_attr_player_loop.attr,
+    &dev_attr_player_first.attr,
+    &dev_attr_player_length.attr,
+    &dev_attr_player_index.attr,
+    &dev_attr_pattern_table.attr,
+    &dev_attr_irq_mask.attr,
+    &dev_attr_irq_events.attr,
+    &dev_attr_irq_raise.attr,
+    &dev_attr_cycle_count.attr,
+    &dev_attr_clock_freq.attr,
+    &dev_attr_write_timestamps.attr,
+    &dev_attr_clock_sync.attr,
+    &dev_attr_fifo_run.attr,
+    &dev_attr_fifo_flush.attr,
+    &dev_attr_fifo_level.attr,
+    &dev_attr_fifo_status.attr,
+    &dev_attr_fifo_watermark.attr,
+    &dev_attr_fifo_depth.attr,
+    &dev_attr_fifo_entries.attr,
+    &dev_attr_pattern.attr,
+    &dev_attr_brightness.attr,
+    &dev_attr_gamma_table.attr,
+    &dev_attr_pattern_firmware.attr,
     NULL,
 };
 ATTRIBUTE_GROUPS(hps_led_patterns);
@@ -295,10 +2358,15 @@ ATTRIBUTE_GROUPS(hps_led_patterns);
 /**
  * hps_led_patterns_read() - Read method for the hps_led_patterns char device
  * @file: Pointer to the char device file struct.
- * @buf: User-space buffer to read the value into.
+ * @buf: User-space buffer to read the values into.
  * @count: The number of bytes being requested.
  * @offset: The byte offset in the file being read from.
  *
+ * Consecutive registers are read one 32-bit word each, up to
+ * MAX_TRANSFER_WORDS words per call; any trailing partial word is ignored.
+ * Reads hold the device lock, so a low/high pair of a 64-bit value read in
+ * one call is consistent.
+ *
  * Return: On success, the number of bytes written is returned and the offset
  *         @offset is advanced by this number. On error, a negative error value
  *         is returned.
@@ -307,7 +2375,8 @@ static ssize_t hps_led_patterns_read(struct file *file, char __user *buf,
     size_t count, loff_t *offset)
 {
     size_t ret;
-    u32 val;
+    u32 vals[MAX_TRANSFER_WORDS];
+    size_t words;
 
     loff_t pos = *offset;
 
@@ -341,21 +2410,93 @@ static ssize_t hps_led_patterns_read(struct file *file, char __user *buf,
     if (count == 0) {
         return 0;
     }
+    if (count < sizeof(u32)) {
+        // Registers can only be read a whole word at a time.
+        return -EINVAL;
+    }
+
+    // Read as many whole words as requested, up to the end of the device.
+    words = min3(count / sizeof(u32), (size_t)(SPAN - pos) / sizeof(u32),
+                 (size_t)MAX_TRANSFER_WORDS);
 
-    // Read the value at offset pos.
-    val = ioread32(priv->base_addr + pos);
+    // Issue the reads back to back, so the bridge can pipeline them.
+    mutex_lock(&priv->lock);
+    for (size_t i = 0; i < words; i++)
+        vals[i] = readl_relaxed(priv->base_addr + pos + i * sizeof(u32));
+    rmb();
+    mutex_unlock(&priv->lock);
 
-    ret = copy_to_user(buf, &val, sizeof(val));
-    if (ret == sizeof(val)) {
+    ret = copy_to_user(buf, vals, words * sizeof(u32));
+    if (ret == words * sizeof(u32)) {
         // Nothing was copied to the user.
         pr_warn("hps_led_patterns_read: nothing copied\n");
         return -EFAULT;
     }
+    // Only report whole words that made it to the user.
+    words -= DIV_ROUND_UP(ret, sizeof(u32));
 
     // Increment the file offset by the number of bytes we read.
-    *offset = pos + sizeof(val);
+    *offset = pos + words * sizeof(u32);
+
+    return words * sizeof(u32);
+}
+
+//-----------------------------------------------------------------------
+// File Operations write() to the write FIFO
+//-----------------------------------------------------------------------
+/**
+ * hps_led_patterns_fifo_write() - Push write FIFO entries from user space.
+ * @priv: hps_led_patterns device to write to.
+ * @buf: User-space buffer holding the entries, as pairs of 32-bit words: an
+ *       LED value followed by a hold time in clock cycles.
+ * @count: The number of bytes being written.
+ *
+ * Called for writes anywhere in the FIFO push window. As many whole entries
+ * as fit in the FIFO are pushed, up to MAX_TRANSFER_WORDS words per call,
+ * and the file offset is left alone, so the next write() pushes more. When
+ * the FIFO is full, nothing is pushed and -EAGAIN is returned; poll() for
+ * the low watermark event (IRQ_FIFO) to sleep until there is room again.
+ *
+ * Return: On success, the number of bytes pushed. On error, a negative error
+ *         value.
+ */
+static ssize_t hps_led_patterns_fifo_write(struct hps_led_patterns_dev *priv,
+    const char __user *buf, size_t count)
+{
+    u32 vals[MAX_TRANSFER_WORDS];
+    size_t entries;
+    size_t left;
+    u32 room;
+
+    if (!priv->fifo_depth)
+        return -ENODEV;
+
+    entries = min(count / (2 * sizeof(u32)), (size_t)MAX_TRANSFER_WORDS / 2);
+    if (entries == 0) {
+        // Entries can only be pushed whole.
+        return -EINVAL;
+    }
+
+    left = copy_from_user(vals, buf, entries * 2 * sizeof(u32));
+    if (left == entries * 2 * sizeof(u32)) {
+        // Nothing was copied from the user.
+        pr_warn("hps_led_patterns_write: nothing copied from user space\n");
+        return -EFAULT;
+    }
+    // Only push whole entries that made it from the user.
+    entries -= DIV_ROUND_UP(left, 2 * sizeof(u32));
+
+    mutex_lock(&priv->lock);
+    room = fifo_room(priv);
+    if (room == 0) {
+        mutex_unlock(&priv->lock);
+        return -EAGAIN;
+    }
+    entries = min_t(size_t, entries, room);
+    fifo_push(priv, entries, vals);
+    mutex_unlock(&priv->lock);
 
-    return sizeof(val);
+    return entries * 2 * sizeof(u32);
 }
 
 //-----------------------------------------------------------------------
@@ -364,10 +2505,18 @@ static ssize_t hps_led_patterns_read(struct file *file, char __user *buf,
 /**
  * hps_led_patterns_write() - Write method for the hps_led_patterns char device
  * @file: Pointer to the char device file struct.
- * @buf: User-space buffer to read the value from.
+ * @buf: User-space buffer to read the values from.
  * @count: The number of bytes being written.
  * @offset: The byte offset in the file being written to.
  *
+ * Consecutive registers are written one 32-bit word each, up to
+ * MAX_TRANSFER_WORDS words per call; any trailing partial word is ignored.
+ * Multi-word writes hold the device lock, so they don't interleave with other
+ * multi-word accesses; single-word writes skip it, so concurrent writers of
+ * individual registers don't queue behind each other, and only hold reg_lock
+ * for the one bus write, to keep out of sysfs read-modify-writes. Writes to the write
+ * FIFO push window are handled by hps_led_patterns_fifo_write() instead.
+ *
  * Return: On success, the number of bytes written is returned and the offset
  *         @offset is advanced by this number. On error, a negative error value
  *         is returned.
@@ -375,8 +2524,9 @@ static ssize_t hps_led_patterns_read(struct file *file, char __user *buf,
 static ssize_t hps_led_patterns_write(struct file *file, const char __user *buf,
     size_t count, loff_t *offset)
 {
-    size_t ret;
-    u32 val;
+    size_t left;
+    u32 vals[MAX_TRANSFER_WORDS];
+    size_t words;
 
     loff_t pos = *offset;
 
@@ -410,29 +2560,141 @@ static ssize_t hps_led_patterns_write(struct file *file, const char __user *buf,
     if (count == 0) {
         return 0;
     }
+    if (count < sizeof(u32)) {
+        // Registers can only be written a whole word at a time.
+        return -EINVAL;
+    }
 
-    mutex_lock(&priv->lock);
+    // Writes to the FIFO push window push whole entries.
+    if (pos >= FIFO_PUSH_OFFSET &&
+        pos < FIFO_PUSH_OFFSET + FIFO_PUSH_WORDS * sizeof(u32)) {
+        return hps_led_patterns_fifo_write(priv, buf, count);
+    }
 
-    ret = copy_from_user(&val, buf, sizeof(val));
-    if (ret == sizeof(val)) {
+    // Write as many whole words as given, up to the end of the device.
+    words = min3(count / sizeof(u32), (size_t)(SPAN - pos) / sizeof(u32),
+                 (size_t)MAX_TRANSFER_WORDS);
+
+    // Copy from the user before taking the lock, since it may fault (and
+    // sleep) while other writers wait.
+    left = copy_from_user(vals, buf, words * sizeof(u32));
+    if (left == words * sizeof(u32)) {
         // Nothing was copied from the user.
         pr_warn("hps_led_patterns_write: nothing copied from user space\n");
-        ret = -EFAULT;
-        goto unlock;
+        return -EFAULT;
+    }
+    // Only write whole words that made it from the user.
+    words -= DIV_ROUND_UP(left, sizeof(u32));
+
+    if (words == 1) {
+        /* A lone word is a single bus write, so it can't tear, and other
+         * writers' multi-word sequences only ever write, so landing in the
+         * middle of one is no different from landing just before it. A
+         * read-modify-write is another matter, since a write between its
+         * read and its write would be undone; those take reg_lock, so only
+         * that (rather than the mutex) is needed here.
+         */
+        spin_lock(&priv->reg_lock);
+        writel(vals[0], priv->base_addr + pos);
+        spin_unlock(&priv->reg_lock);
+    } else {
+        // Write the values we were given, starting at the address offset
+        // given by pos. Post the writes back to back, so the bridge can
+        // pipeline them; the lock keeps them from interleaving with other
+        // multi-word accesses.
+        mutex_lock(&priv->lock);
+        for (size_t i = 0; i < words; i++)
+            writel_relaxed(vals[i], priv->base_addr + pos + i * sizeof(u32));
+        wmb();
+        mutex_unlock(&priv->lock);
     }
-
-    // Write the value we were given at the address offset given by pos.
-    iowrite32(val, priv->base_addr + pos);
 
     // Increment the file offset by the number of bytes we wrote.
-    *offset = pos + sizeof(val);
+    *offset = pos + words * sizeof(u32);
 
     // Return the number of bytes we wrote.
-    ret = sizeof(val);
+    return words * sizeof(u32);
+}
 
-unlock:
-    mutex_unlock(&priv->lock);
-    return ret;
+
+//-----------------------------------------------------------------------
+// File Operations poll()
+//-----------------------------------------------------------------------
+/**
+ * hps_led_patterns_poll() - Poll method for the hps_led_patterns char device
+ * @file: Pointer to the char device file struct.
+ * @wait: Poll table to register our wait queue with.
+ *
+ * Registers can always be read or written, so poll() instead reports events:
+ * EPOLLPRI is set while any event bits are pending in the irq_events
+ * attribute. Clear them there once handled.
+ *
+ * Return: The poll event mask.
+ */
+static __poll_t hps_led_patterns_poll(struct file *file, poll_table *wait)
+{
+    struct hps_led_patterns_dev *priv = container_of(file->private_data,
+                                  struct hps_led_patterns_dev, miscdev);
+
+    poll_wait(file, &priv->event_wait, wait);
+
+    return READ_ONCE(priv->events) ? EPOLLPRI : 0;
+}
+
+
+//-----------------------------------------------------------------------
+// Interrupt Handler
+//-----------------------------------------------------------------------
+/**
+ * hps_led_patterns_irq() - Threaded interrupt handler
+ * @irq: Unused.
+ * @dev_id: The hps_led_patterns_dev that requested the interrupt.
+ *
+ * Acknowledges the pending events, records them for poll() and irq_events
+ * readers, and reports them through the input device: a BTN_0 press and
+ * release for the pushbutton, ABS_MISC for the switch value, and MSC_SCAN
+ * with the new built-in pattern number.
+ *
+ * Return: IRQ_HANDLED if any enabled event was pending, IRQ_NONE otherwise.
+ */
+static irqreturn_t hps_led_patterns_irq(int irq, void *dev_id)
+{
+    struct hps_led_patterns_dev *priv = dev_id;
+
+    u32 status = ioread32(priv->base_addr + REG8_IRQ_STATUS_OFFSET);
+    u32 mask = ioread32(priv->base_addr + REG9_IRQ_MASK_OFFSET);
+    u32 state;
+
+    status &= mask;
+    if (!status) {
+        return IRQ_NONE;
+    }
+    // Acknowledge before sampling the state, so a change racing with us
+    // raises a fresh interrupt rather than being lost
+    iowrite32(status, priv->base_addr + REG8_IRQ_STATUS_OFFSET);
+    state = ioread32(priv->base_addr + REG11_EVENT_STATE_OFFSET);
+
+    spin_lock_irq(&priv->event_lock);
+    priv->events |= status;
+    spin_unlock_irq(&priv->event_lock);
+
+    if (status & IRQ_PB) {
+        input_report_key(priv->input, BTN_0, 1);
+        input_sync(priv->input);
+        input_report_key(priv->input, BTN_0, 0);
+    }
+    if (status & IRQ_SW) {
+        input_report_abs(priv->input, ABS_MISC, EVENT_STATE_SW(state));
+    }
+    if (status & IRQ_PATTERN) {
+        input_event(priv->input, EV_MSC, MSC_SCAN, EVENT_STATE_PATTERN(state));
+    }
+    input_sync(priv->input);
+
+    wake_up_interruptible(&priv->event_wait);
+    sysfs_notify(&priv->miscdev.this_device->kobj, NULL, "irq_events");
+
+    return IRQ_HANDLED;
 }
 
 
@@ -447,6 +2709,7 @@ unlock:
  *         in use.
  * @read: The read function.
  * @write: The write function.
+ * @poll: The poll function; reports pending events as EPOLLPRI.
  * @llseek: We use the kernel's default_llseek() function; this allows users to
  *          change what position they are writing/reading to/from.
  */
@@ -454,6 +2717,7 @@ static const struct file_operations  hps_led_patterns_fops = {
     .owner = THIS_MODULE,
     .read = hps_led_patterns_read,
     .write = hps_led_patterns_write,
+    .poll = hps_led_patterns_poll,
     .llseek = default_llseek,
 };
 
@@ -474,7 +2738,10 @@ static const struct file_operations  hps_led_patterns_fops = {
 static int hps_led_patterns_probe(struct platform_device *pdev)
 {
     struct hps_led_patterns_dev *priv;
+    const char *fw_name = DEFAULT_PATTERN_FIRMWARE;
     int ret;
+    int irq;
+    u32 caps;
 
     /* Allocate kernel memory for the hps_led_patterns device and set it to 0.
      * GFP_KERNEL specifies that we are allocating normal kernel RAM; see the
@@ -498,6 +2765,33 @@ static int hps_led_patterns_probe(struct platform_device *pdev)
         return PTR_ERR(priv->base_addr);
     }
 
+    // Size ourselves from the capability register
+    caps = ioread32(priv->base_addr + REG12_CAPABILITIES_OFFSET);
+    priv->caps = caps;
+    if (caps & CAP_FIFO) {
+        priv->fifo_depth = ioread32(priv->base_addr + REG20_FIFO_DEPTH_OFFSET);
+        pr_info("hps_led_patterns has a %u-entry write FIFO\n", priv->fifo_depth);
+    }
+    priv->led_width = CAP_LED_WIDTH(caps);
+    if (priv->led_width == 0) {
+        priv->led_width = LEGACY_LED_WIDTH;
+    } else if (priv->led_width > 32 * LED_WINDOW_WORDS) {
+        pr_warn("hps_led_patterns has %u LEDs; only the first %u are usable\n",
+                priv->led_width, 32 * LED_WINDOW_WORDS);
+        priv->led_width = 32 * LED_WINDOW_WORDS;
+    }
+    priv->led_words = DIV_ROUND_UP(priv->led_width, 32);
+    pr_info("hps_led_patterns has %u LEDs\n", priv->led_width);
+    if (caps & CAP_PWM)
+        priv->pwm_width = min_t(u32, priv->led_width, BRIGHTNESS_LEDS);
+
+    mutex_init(&priv->lock);
+    spin_lock_init(&priv->reg_lock);
+    init_waitqueue_head(&priv->event_wait);
+    spin_lock_init(&priv->event_lock);
+    mutex_init(&priv->fw_lock);
+    init_completion(&priv->fw_done);
+
     // Initialize the misc device parameters
     priv->miscdev.minor = MISC_DYNAMIC_MINOR;
     priv->miscdev.name = "hps_led_patterns";
@@ -517,9 +2811,68 @@ static int hps_led_patterns_probe(struct platform_device *pdev)
     // struct.
     platform_set_drvdata(pdev, priv);
 
+    // Create an input device for pushbutton, switch and pattern events
+    priv->input = devm_input_allocate_device(&pdev->dev);
+    if (!priv->input) {
+        pr_err("Failed to allocate input device for hps_led_patterns\n");
+        ret = -ENOMEM;
+        goto deregister;
+    }
+    priv->input->name = "hps_led_patterns";
+    priv->input->phys = "hps_led_patterns/input0";
+    input_set_capability(priv->input, EV_KEY, BTN_0);
+    input_set_capability(priv->input, EV_MSC, MSC_SCAN);
+    input_set_abs_params(priv->input, ABS_MISC, 0, 0xF, 0, 0);
+    ret = input_register_device(priv->input);
+    if (ret) {
+        pr_err("Failed to register input device for hps_led_patterns\n");
+        goto deregister;
+    }
+
+    /* Request the interrupt from the device tree, if there is one. Events are
+     * masked until the handler is in place, and then all of them are enabled.
+     * Without an interrupt, the driver works as before, but poll() and the
+     * input device never report anything.
+     */
+    iowrite32(0, priv->base_addr + REG9_IRQ_MASK_OFFSET);
+    iowrite32(IRQ_ALL, priv->base_addr + REG8_IRQ_STATUS_OFFSET);
+    irq = platform_get_irq_optional(pdev, 0);
+    if (irq == -EPROBE_DEFER) {
+        ret = irq;
+        goto deregister;
+    }
+    if (irq > 0) {
+        ret = devm_request_threaded_irq(&pdev->dev, irq, NULL,
+                hps_led_patterns_irq, IRQF_ONESHOT, "hps_led_patterns", priv);
+        if (ret) {
+            pr_err("Failed to request interrupt for hps_led_patterns\n");
+            goto deregister;
+        }
+        iowrite32(IRQ_ALL, priv->base_addr + REG9_IRQ_MASK_OFFSET);
+    } else {
+        pr_warn("No interrupt for hps_led_patterns; events are unavailable\n");
+    }
+
+    /* Start loading a pattern table to play, without holding up probe. The
+     * device tree node may name the file; otherwise, the default is used.
+     * Until (unless) it arrives, the built-in patterns show as usual.
+     */
+    of_property_read_string(pdev->dev.of_node, "firmware-name", &fw_name);
+    strscpy(priv->fw_name, fw_name, sizeof(priv->fw_name));
+    ret = request_firmware_nowait(THIS_MODULE, FW_ACTION_UEVENT, priv->fw_name,
+            &pdev->dev, GFP_KERNEL, priv, pattern_firmware_loaded);
+    if (ret) {
+        pr_warn("Failed to request pattern firmware %s\n", priv->fw_name);
+        complete(&priv->fw_done);
+    }
+
     pr_info("hps_led_patterns_probe successful\n");
 
     return 0;
+
+deregister:
+    misc_deregister(&priv->miscdev);
+    return ret;
 }
 
 //-----------------------------------------------------------------------
@@ -538,6 +2891,12 @@ static int hps_led_patterns_remove(struct platform_device *pdev)
     // Get the hps_led_patterns' private data from the platform device.
     struct hps_led_patterns_dev *priv = platform_get_drvdata(pdev);
 
+    // Let any pattern firmware load started at probe finish first.
+    wait_for_completion(&priv->fw_done);
+
+    // Stop interrupts before the handler is freed.
+    iowrite32(0, priv->base_addr + REG9_IRQ_MASK_OFFSET);
+
     // Deregister the misc device and remove the /dev/hps_led_patterns file.
     misc_deregister(&priv->miscdev);
 
@@ -0,0 +1,375 @@
+// Access-path latency benchmark for the hps_led_patterns registers
+//
+// Runs the same read, write and read-modify-write workloads on LED_reg over
+// each way of reaching it, and reports throughput and latency percentiles,
+// as a table or as JSON for trend tracking:
+//   sysfs    the driver's led_reg attribute
+//   chardev  the driver's /dev/hps_led_patterns char device
+//   devmem   a /dev/mem mapping, as used by myLEDpatterns and mydevmem
+//   cosim    the GHDL co-simulation of the RTL (led-patterns/cosim)
+//   anon     plain memory standing in for the registers, as a baseline for
+//            the benchmark's own overhead
+//
+// Build with `make bench` (add CROSS_COMPILE= for the host), or directly:
+//   gcc -O2 -Wall -I../../led-patterns/cosim -o hps_led_patterns_bench hps_led_patterns_bench.c
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <errno.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/utsname.h>
+
+#include "reg_offsets.h"
+#include "cosim_client.h"
+
+#define SYSFS_LED_REG "/sys/class/misc/hps_led_patterns/led_reg"
+// led_reg shows one hex digit per four LEDs, so "0x", 1024 digits and a
+// newline at most
+#define SYSFS_LED_REG_LEN 1028
+#define CHARDEV "/dev/hps_led_patterns"
+#define BRIDGE_BASE_ADDR 0xFF200000
+#define SPAN 0x1000
+#define DEFAULT_COUNT 10000
+#define NSEC_PER_SEC 1000000000ull
+
+enum path {PATH_SYSFS, PATH_CHARDEV, PATH_DEVMEM, PATH_COSIM, PATH_ANON, NUM_PATHS};
+static const char *path_names[NUM_PATHS] = {
+    [PATH_SYSFS] = "sysfs",
+    [PATH_CHARDEV] = "chardev",
+    [PATH_DEVMEM] = "devmem",
+    [PATH_COSIM] = "cosim",
+    [PATH_ANON] = "anon",
+};
+
+enum workload {WORK_READ, WORK_WRITE, WORK_RMW, NUM_WORKLOADS};
+static const char *workload_names[NUM_WORKLOADS] = {
+    [WORK_READ] = "read",
+    [WORK_WRITE] = "write",
+    [WORK_RMW] = "rmw",
+};
+
+// An open access path
+struct target {
+    enum path path;
+    int fd;
+    void *map;
+    volatile uint32_t *led_reg;
+};
+
+struct result {
+    double ops_per_sec;
+    uint64_t min, p50, p99, p999, max;  // Nanoseconds
+};
+
+
+static inline uint64_t clock_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+    return (uint64_t)ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+}
+
+static void fail(const struct target *t, const char *what) {
+    fprintf(stderr, "%s: %s failed: %s\n", path_names[t->path], what, strerror(errno));
+    exit(1);
+}
+
+
+// Open an access path; returns 0, or -1 if it isn't available here
+static int open_target(struct target *t, enum path path, const char *socket_path) {
+    *t = (struct target) {.path = path, .fd = -1};
+    switch (path) {
+        case PATH_SYSFS:
+            t->fd = open(SYSFS_LED_REG, O_RDWR);
+            break;
+        case PATH_CHARDEV:
+            t->fd = open(CHARDEV, O_RDWR);
+            break;
+        case PATH_DEVMEM:
+            t->fd = open("/dev/mem", O_RDWR | O_SYNC);
+            if (t->fd == -1) {
+                break;
+            }
+            t->map = mmap(NULL, SPAN, PROT_READ | PROT_WRITE, MAP_SHARED, t->fd, BRIDGE_BASE_ADDR);
+            if (t->map == MAP_FAILED) {
+                close(t->fd);
+                return -1;
+            }
+            t->led_reg = (volatile uint32_t *)((char *)t->map + REG1_LED_REG_OFFSET);
+            return 0;
+        case PATH_COSIM:
+            t->fd = cosim_connect(socket_path);
+            break;
+        case PATH_ANON:
+            t->map = mmap(NULL, SPAN, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (t->map == MAP_FAILED) {
+                return -1;
+            }
+            t->led_reg = (volatile uint32_t *)((char *)t->map + REG1_LED_REG_OFFSET);
+            return 0;
+        default:
+            return -1;
+    }
+    return t->fd == -1 ? -1 : 0;
+}
+
+static void close_target(struct target *t) {
+    if (t->map) {
+        munmap(t->map, SPAN);
+    }
+    if (t->fd != -1) {
+        close(t->fd);
+    }
+}
+
+static inline uint32_t reg_read(const struct target *t) {
+    uint32_t value = 0;
+    char buf[SYSFS_LED_REG_LEN + 1];
+    ssize_t len;
+    switch (t->path) {
+        case PATH_SYSFS:
+            // sysfs regenerates the attribute on every read from offset 0
+            len = pread(t->fd, buf, sizeof(buf) - 1, 0);
+            if (len <= 0) {
+                fail(t, "read");
+            }
+            buf[len] = '\0';
+            // Like the other paths, keep only the first word of LEDs: the
+            // last eight hex digits
+            len = strcspn(buf, "\n");
+            value = strtoul(buf + (len > 8 ? len - 8 : 0), NULL, 16);
+            break;
+        case PATH_CHARDEV:
+            if (pread(t->fd, &value, sizeof(value), REG1_LED_REG_OFFSET) != sizeof(value)) {
+                fail(t, "read");
+            }
+            break;
+        case PATH_COSIM:
+            if (cosim_read(t->fd, REG1_LED_REG_OFFSET, &value)) {
+                fail(t, "read");
+            }
+            break;
+        default:
+            value = *t->led_reg;
+            break;
+    }
+    return value;
+}
+
+static inline void reg_write(const struct target *t, uint32_t value) {
+    char buf[16];
+    int len;
+    switch (t->path) {
+        case PATH_SYSFS:
+            len = snprintf(buf, sizeof(buf), "0x%X\n", value);
+            if (pwrite(t->fd, buf, len, 0) != len) {
+                fail(t, "write");
+            }
+            break;
+        case PATH_CHARDEV:
+            if (pwrite(t->fd, &value, sizeof(value), REG1_LED_REG_OFFSET) != sizeof(value)) {
+                fail(t, "write");
+            }
+            break;
+        case PATH_COSIM:
+            if (cosim_write(t->fd, REG1_LED_REG_OFFSET, value)) {
+                fail(t, "write");
+            }
+            break;
+        default:
+            *t->led_reg = value;
+            break;
+    }
+}
+
+static inline uint32_t run_op(const struct target *t, enum workload work, uint32_t i) {
+    switch (work) {
+        case WORK_READ:
+            return reg_read(t);
+        case WORK_WRITE:
+            reg_write(t, i & 0xFF);
+            return 0;
+        default:
+            // Toggle one LED, as a driver or application would
+            reg_write(t, reg_read(t) ^ (1u << (i % 8)));
+            return 0;
+    }
+}
+
+
+static int cmp_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+// Run one workload: an untimed pass for throughput, then a pass timing each
+// operation (less the cost of taking the timestamps)
+static void run_workload(const struct target *t, enum workload work, unsigned long count,
+        uint64_t *lat, uint64_t overhead, struct result *r) {
+    uint32_t sink = 0;
+
+    // Warm up caches and any lazily set-up kernel state
+    for (unsigned long i = 0; i < count / 100 + 1; i++) {
+        sink += run_op(t, work, i);
+    }
+
+    uint64_t start = clock_ns();
+    for (unsigned long i = 0; i < count; i++) {
+        sink += run_op(t, work, i);
+    }
+    r->ops_per_sec = count / ((double)(clock_ns() - start) / NSEC_PER_SEC);
+
+    for (unsigned long i = 0; i < count; i++) {
+        uint64_t t0 = clock_ns();
+        sink += run_op(t, work, i);
+        uint64_t dt = clock_ns() - t0;
+        lat[i] = dt > overhead ? dt - overhead : 0;
+    }
+    qsort(lat, count, sizeof(*lat), cmp_u64);
+    r->min = lat[0];
+    r->p50 = lat[count / 2];
+    r->p99 = lat[count * 99 / 100];
+    r->p999 = lat[count * 999 / 1000];
+    r->max = lat[count - 1];
+
+    // Keep the compiler honest about the reads
+    if (sink == 0xDEADBEEF) {
+        putchar(' ');
+    }
+}
+
+// Parse a comma-separated list of names into a bitmask
+static unsigned int parse_names(const char *arg, const char **names, int num_names) {
+    unsigned int mask = 0;
+    char *list = strdup(arg);
+    for (char *name = strtok(list, ","); name; name = strtok(NULL, ",")) {
+        int i;
+        for (i = 0; i < num_names && strcmp(name, names[i]) != 0; i++) {
+        }
+        if (i == num_names) {
+            fprintf(stderr, "Unknown name \"%s\"\n", name);
+            exit(2);
+        }
+        mask |= 1u << i;
+    }
+    free(list);
+    return mask;
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr,
+        "Usage: %s [-p PATHS] [-w WORKLOADS] [-n COUNT] [-s SOCKET] [-j]\n"
+        "  -p  comma-separated access paths: sysfs, chardev, devmem, cosim, anon\n"
+        "      (default: sysfs,chardev,devmem; unavailable ones are skipped)\n"
+        "  -w  comma-separated workloads: read, write, rmw (default: all)\n"
+        "  -n  operations per path and workload (default: %d)\n"
+        "  -s  co-simulation socket (default: " COSIM_DEFAULT_SOCKET ")\n"
+        "  -j  print JSON instead of a table\n",
+        prog, DEFAULT_COUNT);
+}
+
+
+int main(int argc, char **argv) {
+    unsigned int paths = (1u << PATH_SYSFS) | (1u << PATH_CHARDEV) | (1u << PATH_DEVMEM);
+    unsigned int workloads = (1u << NUM_WORKLOADS) - 1;
+    unsigned long count = DEFAULT_COUNT;
+    const char *socket_path = COSIM_DEFAULT_SOCKET;
+    bool json = false;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "p:w:n:s:jh")) != -1) {
+        switch (opt) {
+            case 'p': paths = parse_names(optarg, path_names, NUM_PATHS); break;
+            case 'w': workloads = parse_names(optarg, workload_names, NUM_WORKLOADS); break;
+            case 'n': count = strtoul(optarg, NULL, 0); break;
+            case 's': socket_path = optarg; break;
+            case 'j': json = true; break;
+            default:
+                usage(argv[0]);
+                return opt == 'h' ? 0 : 2;
+        }
+    }
+    if (count == 0) {
+        fputs("Count must be nonzero\n", stderr);
+        return 2;
+    }
+
+    uint64_t *lat = malloc(count * sizeof(*lat));
+    if (lat == NULL) {
+        fputs("Failed to allocate latency buffer\n", stderr);
+        return 1;
+    }
+
+    // Cost of back-to-back timestamps, subtracted from each sample
+    uint64_t overhead = UINT64_MAX;
+    for (int i = 0; i < 1000; i++) {
+        uint64_t t0 = clock_ns();
+        uint64_t dt = clock_ns() - t0;
+        if (dt < overhead) {
+            overhead = dt;
+        }
+    }
+
+    if (json) {
+        struct utsname host;
+        uname(&host);
+        printf("{\n  \"benchmark\": \"hps_led_patterns_bench\",\n"
+               "  \"host\": \"%s\",\n  \"time\": %ld,\n  \"count\": %lu,\n"
+               "  \"timer_overhead_ns\": %llu,\n  \"results\": [",
+               host.nodename, (long)time(NULL), count, (unsigned long long)overhead);
+    } else {
+        printf("%-8s %-6s %12s %9s %9s %9s %9s %9s\n",
+               "path", "work", "ops/s", "min_ns", "p50_ns", "p99_ns", "p999_ns", "max_ns");
+    }
+
+    bool first = true;
+    for (enum path path = 0; path < NUM_PATHS; path++) {
+        struct target t;
+        if (!(paths & (1u << path))) {
+            continue;
+        }
+        if (open_target(&t, path, socket_path)) {
+            fprintf(stderr, "Skipping %s: %s\n", path_names[path], strerror(errno));
+            continue;
+        }
+        // Leave LED_reg as we found it
+        uint32_t saved = reg_read(&t);
+        for (enum workload work = 0; work < NUM_WORKLOADS; work++) {
+            struct result r;
+            if (!(workloads & (1u << work))) {
+                continue;
+            }
+            run_workload(&t, work, count, lat, overhead, &r);
+            if (json) {
+                printf("%s\n    {\"path\": \"%s\", \"workload\": \"%s\", \"ops_per_sec\": %.1f, "
+                       "\"min_ns\": %llu, \"p50_ns\": %llu, \"p99_ns\": %llu, "
+                       "\"p999_ns\": %llu, \"max_ns\": %llu}",
+                       first ? "" : ",", path_names[path], workload_names[work], r.ops_per_sec,
+                       (unsigned long long)r.min, (unsigned long long)r.p50,
+                       (unsigned long long)r.p99, (unsigned long long)r.p999,
+                       (unsigned long long)r.max);
+            } else {
+                printf("%-8s %-6s %12.0f %9llu %9llu %9llu %9llu %9llu\n",
+                       path_names[path], workload_names[work], r.ops_per_sec,
+                       (unsigned long long)r.min, (unsigned long long)r.p50,
+                       (unsigned long long)r.p99, (unsigned long long)r.p999,
+                       (unsigned long long)r.max);
+            }
+            fflush(stdout);
+            first = false;
+        }
+        reg_write(&t, saved);
+        close_target(&t);
+    }
+    if (json) {
+        printf("\n  ]\n}\n");
+    }
+
+    free(lat);
+    return 0;
+}
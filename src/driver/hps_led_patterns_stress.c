@@ -0,0 +1,365 @@
+// Contention stress test for the hps_led_patterns char device
+//
+// Runs N agents (threads, or processes with -P) against the device at once,
+// for each N in a list, each mixing reads and writes:
+//   - single-word writes and read-backs of a pattern table duration that only
+//     that agent uses, which must always read back as last written
+//   - two-word writes and reads of one shared pattern table entry, always
+//     written as a matching pair (LED value v, duration v * 0x101), which
+//     must never read back torn
+// and reports throughput against agent count, with any inconsistencies.
+// With -F, each step also races single-word writes of FIFO_control, toggling
+// its run bit, against the fifo_flush attribute's read-modify-write of the
+// same register; the run bit must always read back as last written.
+// The pattern table entries and FIFO run bit it uses are restored
+// afterwards, but don't run the pattern player or the FIFO meanwhile.
+//
+// Build with `make stress` (add CROSS_COMPILE= for the host), or directly:
+//   gcc -O2 -Wall -pthread -o hps_led_patterns_stress hps_led_patterns_stress.c
+
+#define _GNU_SOURCE
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <errno.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+#include "reg_offsets.h"
+
+#define CHARDEV "/dev/hps_led_patterns"
+#define SYSFS_DIR "/sys/class/misc/hps_led_patterns"
+#define MAX_AGENTS 64
+#define MAX_STEPS 16
+// The shared entry is the last in the table, and agent n owns the duration of
+// the entry before it, counting down
+#define SHARED_ENTRY (PATTERN_TABLE_ENTRIES - 1)
+#define OWN_ENTRY(n) (PATTERN_TABLE_ENTRIES - 2 - (n))
+
+// Per-agent counters, each on its own cache line; shared between processes
+struct agent_stats {
+    uint64_t reads;
+    uint64_t writes;
+    uint64_t errors;
+} __attribute__((aligned(64)));
+
+struct shared {
+    volatile bool stop;
+    volatile bool reported;  // Only the first inconsistency is printed
+    struct agent_stats agents[MAX_AGENTS];
+    struct agent_stats fifo[2];  // The FIFO_control writer and flusher, with -F
+};
+
+static const char *device = CHARDEV;
+static const char *sysfs_dir = SYSFS_DIR;
+static unsigned int read_pct = 50;
+static struct shared *shared;
+
+
+// Report an inconsistency seen by agent `id`, or by the FIFO writer if negative
+static void report_error(const char *fmt, int id, uint32_t a, uint32_t b) {
+    if (!__atomic_exchange_n(&shared->reported, true, __ATOMIC_RELAXED)) {
+        if (id < 0) {
+            fputs("FIFO writer: ", stderr);
+        } else {
+            fprintf(stderr, "agent %d: ", id);
+        }
+        fprintf(stderr, fmt, a, b);
+        fputc('\n', stderr);
+    }
+}
+
+// One agent's workload, until told to stop
+static void run_agent(int id) {
+    struct agent_stats *stats = &shared->agents[id];
+    off_t own = PATTERN_TABLE_DURATION_OFFSET(OWN_ENTRY(id));
+    off_t pair = PATTERN_TABLE_LED_OFFSET(SHARED_ENTRY);
+    uint32_t seed = 0x9E3779B9u * (id + 1);
+    uint32_t last = 0;
+    bool written = false;
+
+    int fd = open(device, O_RDWR);
+    if (fd == -1) {
+        fprintf(stderr, "agent %d: failed to open %s: %s\n", id, device, strerror(errno));
+        stats->errors++;
+        return;
+    }
+    while (!shared->stop) {
+        uint32_t words[2];
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+        bool is_read = seed % 100 < read_pct;
+        bool is_pair = seed & 0x100;
+
+        if (is_read && is_pair) {
+            if (pread(fd, words, sizeof(words), pair) != sizeof(words)) {
+                stats->errors++;
+            } else if (words[1] != words[0] * 0x101) {
+                report_error("torn pair read: LED 0x%X with duration 0x%X", id, words[0], words[1]);
+                stats->errors++;
+            }
+            stats->reads++;
+        } else if (is_read) {
+            if (pread(fd, words, sizeof(words[0]), own) != sizeof(words[0])) {
+                stats->errors++;
+            } else if (written && words[0] != last) {
+                report_error("own duration read back 0x%X, wrote 0x%X", id, words[0], last);
+                stats->errors++;
+            }
+            stats->reads++;
+        } else if (is_pair) {
+            words[0] = seed >> 24;
+            words[1] = words[0] * 0x101;
+            if (pwrite(fd, words, sizeof(words), pair) != sizeof(words)) {
+                stats->errors++;
+            }
+            stats->writes++;
+        } else {
+            last = (last + 1) & 0xFFFF;
+            if (pwrite(fd, &last, sizeof(last), own) != sizeof(last)) {
+                stats->errors++;
+            }
+            written = true;
+            stats->writes++;
+        }
+    }
+    close(fd);
+}
+
+// Toggle FIFO_control's run bit with single-word writes, checking each time
+// that it still reads back as last written, until told to stop
+static void run_fifo_writer(void) {
+    struct agent_stats *stats = &shared->fifo[0];
+    uint32_t control = 0;
+
+    int fd = open(device, O_RDWR);
+    if (fd == -1) {
+        fprintf(stderr, "FIFO writer: failed to open %s: %s\n", device, strerror(errno));
+        stats->errors++;
+        return;
+    }
+    if (pwrite(fd, &control, sizeof(control), REG16_FIFO_CONTROL_OFFSET) != sizeof(control)) {
+        stats->errors++;
+    }
+    while (!shared->stop) {
+        uint32_t word;
+        if (pread(fd, &word, sizeof(word), REG16_FIFO_CONTROL_OFFSET) != sizeof(word)) {
+            stats->errors++;
+        } else if ((word & FIFO_CONTROL_RUN) != control) {
+            report_error("FIFO_control read back 0x%X, wrote 0x%X", -1, word, control);
+            stats->errors++;
+        }
+        control ^= FIFO_CONTROL_RUN;
+        if (pwrite(fd, &control, sizeof(control), REG16_FIFO_CONTROL_OFFSET) != sizeof(control)) {
+            stats->errors++;
+        }
+        stats->reads++;
+        stats->writes++;
+    }
+    close(fd);
+}
+
+// Flush the FIFO through sysfs, which reads FIFO_control and writes it back
+// with the flush bit set, until told to stop
+static void run_fifo_flusher(void) {
+    struct agent_stats *stats = &shared->fifo[1];
+    char path[256];
+
+    snprintf(path, sizeof(path), "%s/fifo_flush", sysfs_dir);
+    int fd = open(path, O_WRONLY);
+    if (fd == -1) {
+        fprintf(stderr, "FIFO flusher: failed to open %s: %s\n", path, strerror(errno));
+        stats->errors++;
+        return;
+    }
+    while (!shared->stop) {
+        if (pwrite(fd, "1\n", 2, 0) != 2) {
+            stats->errors++;
+        }
+        stats->writes++;
+    }
+    close(fd);
+}
+
+static void *agent_thread(void *arg) {
+    run_agent((intptr_t)arg);
+    return NULL;
+}
+
+static void *fifo_writer_thread(void *arg) {
+    run_fifo_writer();
+    return NULL;
+}
+
+static void *fifo_flusher_thread(void *arg) {
+    run_fifo_flusher();
+    return NULL;
+}
+
+
+static uint64_t clock_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+// Run `agents` agents (plus the FIFO_control race, if `fifo`) for `seconds`,
+// and return the agents' total operations per second; errors are added to
+// *errors
+static double run_step(int agents, bool processes, bool fifo, double seconds, uint64_t *errors) {
+    pthread_t threads[MAX_AGENTS], fifo_threads[2];
+    struct timespec duration = {(time_t)seconds, (long)((seconds - (time_t)seconds) * 1e9)};
+    pid_t pids[MAX_AGENTS];
+
+    memset(shared->agents, 0, sizeof(shared->agents));
+    memset(&shared->fifo, 0, sizeof(shared->fifo));
+    shared->stop = false;
+    if (fifo) {
+        pthread_create(&fifo_threads[0], NULL, fifo_writer_thread, NULL);
+        pthread_create(&fifo_threads[1], NULL, fifo_flusher_thread, NULL);
+    }
+    uint64_t start = clock_ns();
+    for (int i = 0; i < agents; i++) {
+        if (processes) {
+            pids[i] = fork();
+            if (pids[i] == 0) {
+                run_agent(i);
+                _exit(0);
+            }
+        } else {
+            pthread_create(&threads[i], NULL, agent_thread, (void *)(intptr_t)i);
+        }
+    }
+    nanosleep(&duration, NULL);
+    shared->stop = true;
+    for (int i = 0; i < agents; i++) {
+        if (processes) {
+            waitpid(pids[i], NULL, 0);
+        } else {
+            pthread_join(threads[i], NULL);
+        }
+    }
+    double elapsed = (clock_ns() - start) / 1e9;
+    if (fifo) {
+        pthread_join(fifo_threads[0], NULL);
+        pthread_join(fifo_threads[1], NULL);
+    }
+
+    uint64_t ops = 0;
+    for (int i = 0; i < agents; i++) {
+        ops += shared->agents[i].reads + shared->agents[i].writes;
+        *errors += shared->agents[i].errors;
+    }
+    *errors += shared->fifo[0].errors + shared->fifo[1].errors;
+    return ops / elapsed;
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr,
+        "Usage: %s [-t AGENTS] [-d SECONDS] [-r PERCENT] [-P] [-F] [-f DEVICE] [-s DIR]\n"
+        "  -t  comma-separated agent counts to step through (default: 1,2,4,8)\n"
+        "  -d  run time per step (default: 2)\n"
+        "  -r  percentage of operations that are reads (default: 50)\n"
+        "  -P  run agents as processes rather than threads\n"
+        "  -F  also race FIFO_control writes against the fifo_flush attribute\n"
+        "  -f  device to test (default: " CHARDEV ")\n"
+        "  -s  device's sysfs directory, for -F (default: " SYSFS_DIR ")\n",
+        prog);
+}
+
+
+int main(int argc, char **argv) {
+    int steps[MAX_STEPS] = {1, 2, 4, 8};
+    int num_steps = 4;
+    double seconds = 2;
+    bool processes = false;
+    bool fifo = false;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "t:d:r:PFf:s:h")) != -1) {
+        switch (opt) {
+            case 't': {
+                char *arg = optarg, *end;
+                for (num_steps = 0; *arg && num_steps < MAX_STEPS; num_steps++) {
+                    steps[num_steps] = strtol(arg, &end, 0);
+                    if (end == arg || steps[num_steps] < 1 || steps[num_steps] > MAX_AGENTS) {
+                        fprintf(stderr, "Agent counts must be 1 to %d\n", MAX_AGENTS);
+                        return 2;
+                    }
+                    arg = (*end == ',') ? end + 1 : end;
+                }
+                break;
+            }
+            case 'd': seconds = strtod(optarg, NULL); break;
+            case 'r': read_pct = strtoul(optarg, NULL, 0); break;
+            case 'P': processes = true; break;
+            case 'F': fifo = true; break;
+            case 'f': device = optarg; break;
+            case 's': sysfs_dir = optarg; break;
+            default:
+                usage(argv[0]);
+                return opt == 'h' ? 0 : 2;
+        }
+    }
+
+    shared = mmap(NULL, sizeof(*shared), PROT_READ | PROT_WRITE,
+                  MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (shared == MAP_FAILED) {
+        fputs("Failed to allocate shared counters\n", stderr);
+        return 1;
+    }
+
+    // Save the table entries we use, and start the shared pair out matched
+    int fd = open(device, O_RDWR);
+    if (fd == -1) {
+        fprintf(stderr, "Failed to open %s: %s\n", device, strerror(errno));
+        return 1;
+    }
+    off_t saved_offset = PATTERN_TABLE_LED_OFFSET(OWN_ENTRY(MAX_AGENTS - 1));
+    uint32_t saved[2 * (MAX_AGENTS + 1)];
+    uint32_t matched[2] = {0, 0};
+    uint32_t saved_control = 0;
+    if (pread(fd, saved, sizeof(saved), saved_offset) != sizeof(saved)
+            || pwrite(fd, matched, sizeof(matched), PATTERN_TABLE_LED_OFFSET(SHARED_ENTRY)) != sizeof(matched)) {
+        fprintf(stderr, "Failed to set up the pattern table: %s\n", strerror(errno));
+        return 1;
+    }
+    if (fifo && pread(fd, &saved_control, sizeof(saved_control), REG16_FIFO_CONTROL_OFFSET) != sizeof(saved_control)) {
+        fprintf(stderr, "Failed to read FIFO_control: %s\n", strerror(errno));
+        return 1;
+    }
+    saved_control &= FIFO_CONTROL_RUN;
+
+    printf("%-8s %12s %12s %8s %8s\n", "agents", "ops/s", "ops/s/agent", "scaling", "errors");
+    double base = 0;
+    uint64_t total_errors = 0;
+    for (int i = 0; i < num_steps; i++) {
+        uint64_t errors = 0;
+        double rate = run_step(steps[i], processes, fifo, seconds, &errors);
+        if (i == 0) {
+            base = rate / steps[i];
+        }
+        printf("%-8d %12.0f %12.0f %7.2fx %8llu\n", steps[i], rate, rate / steps[i],
+               rate / base, (unsigned long long)errors);
+        fflush(stdout);
+        total_errors += errors;
+    }
+
+    pwrite(fd, saved, sizeof(saved), saved_offset);
+    if (fifo) {
+        pwrite(fd, &saved_control, sizeof(saved_control), REG16_FIFO_CONTROL_OFFSET);
+    }
+    close(fd);
+    if (total_errors) {
+        fprintf(stderr, "%llu inconsistent or failed operations\n", (unsigned long long)total_errors);
+        return 3;
+    }
+    return 0;
+}
@@ -2,7 +2,7 @@
 # Test driver for the hps_led_patterns device, via its custom kernel driver
 
 device=/sys/class/misc/hps_led_patterns
-regs="hps_led_control led_reg base_rate"
+regs="hps_led_control led_reg base_rate player_run player_loop player_first player_length player_index irq_mask irq_events"
 
 # Helper functions
 read_register () {
@@ -33,3 +33,85 @@ for reg in $regs
 do
     read_register $reg
 done
+
+echo ":: Uploading and playing a pattern table..."
+printf '0x81 4\n0x42 4\n0x24 4\n0x18 4\n' > "$device/pattern_table"
+cat "$device/pattern_table"
+write_register hps_led_control 0
+write_register player_loop 1
+write_register player_run 1
+sleep 1
+read_register player_run
+read_register player_index
+write_register player_run 0
+read_register player_run
+
+echo ":: Raising simulated interrupts..."
+write_register irq_mask 0x7
+write_register irq_events 0x7
+read_register irq_events
+write_register irq_raise 0x5
+sleep 0.1
+read_register irq_events
+write_register irq_events 0x7
+read_register irq_events
+
+echo ":: Reading the cycle counter and write timestamps..."
+read_register clock_freq
+read_register cycle_count
+write_register led_reg 0x55
+cat "$device/clock_sync"
+cat "$device/write_timestamps"
+
+echo ":: Playing entries through the write FIFO..."
+read_register fifo_depth
+write_register hps_led_control 1
+write_register fifo_watermark 1
+printf '0x81 5000000\n0x42 5000000\n0x24 5000000\n0x18 5000000\n' > "$device/fifo_entries"
+read_register fifo_level
+write_register fifo_run 1
+sleep 0.5
+read_register fifo_level
+read_register fifo_status
+write_register fifo_run 0
+write_register fifo_status 0x18
+write_register hps_led_control 0
+
+echo ":: Selecting built-in patterns..."
+read_register pattern
+write_register pattern count_up
+read_register pattern
+write_register pattern 1
+read_register pattern
+
+echo ":: Setting a high-resolution base period..."
+read_register base_period
+write_register base_period 0.000016
+read_register base_period
+read_register base_rate
+write_register base_rate 1
+read_register base_period
+
+echo ":: Fading an LED with PWM brightness..."
+read_register brightness
+write_register hps_led_control 1
+write_register led_reg 0xFF
+for level in 255 192 128 64 32 16 0; do
+    write_register brightness "$level"
+    sleep 0.1
+done
+write_register brightness "255 255 255 255 255 255 255 255"
+read_register brightness
+head -n 2 "$device/gamma_table"
+write_register hps_led_control 0
+
+echo ":: Loading a pattern table from firmware..."
+read_register pattern_firmware
+printf 'base_rate 0.25\n0x81 1\n0x42 1\n0x24 1\n0x18 1\n' > /lib/firmware/hps_led_patterns_test.pat
+write_register pattern_firmware hps_led_patterns_test.pat
+read_register pattern_firmware
+read_register base_rate
+cat "$device/pattern_table"
+sleep 2
+write_register player_run 0
+rm /lib/firmware/hps_led_patterns_test.pat
@@ -5,8 +5,123 @@
 #define REG0_HPS_LED_CONTROL_OFFSET 0x0
 #define REG1_LED_REG_OFFSET 0x4
 #define REG2_BASE_RATE_OFFSET 0x8
+#define REG3_PLAYER_CONTROL_OFFSET 0xC
+#define REG4_PLAYER_LOOP_OFFSET 0x10
+#define REG5_PLAYER_FIRST_OFFSET 0x14
+#define REG6_PLAYER_LENGTH_OFFSET 0x18
+#define REG7_PLAYER_INDEX_OFFSET 0x1C
+#define REG8_IRQ_STATUS_OFFSET 0x20
+#define REG9_IRQ_MASK_OFFSET 0x24
+#define REG10_IRQ_RAISE_OFFSET 0x28
+#define REG11_EVENT_STATE_OFFSET 0x2C
+#define REG12_CAPABILITIES_OFFSET 0x30
+#define REG13_COUNTER_LO_OFFSET 0x34
+#define REG14_COUNTER_HI_OFFSET 0x38
+#define REG15_CLOCK_FREQ_OFFSET 0x3C
+#define REG16_FIFO_CONTROL_OFFSET 0x40
+#define REG17_FIFO_LEVEL_OFFSET 0x44
+#define REG18_FIFO_STATUS_OFFSET 0x48
+#define REG19_FIFO_WATERMARK_OFFSET 0x4C
+#define REG20_FIFO_DEPTH_OFFSET 0x50
+#define REG21_PATTERN_SELECT_OFFSET 0x54
+#define REG22_BASE_PERIOD_OFFSET 0x58
+
+// Player control register bits (start/stop on write, busy on read)
+#define PLAYER_CONTROL_START 0x1
+#define PLAYER_CONTROL_STOP 0x2
+#define PLAYER_CONTROL_BUSY 0x1
+
+// Interrupt sources, as bits of the IRQ status, mask and raise registers
+#define IRQ_PB 0x1
+#define IRQ_SW 0x2
+#define IRQ_PATTERN 0x4
+#define IRQ_FIFO 0x8
+#define IRQ_ALL (IRQ_PB | IRQ_SW | IRQ_PATTERN | IRQ_FIFO)
+
+// Event state register fields: current switches and built-in pattern
+#define EVENT_STATE_SW(x) ((x) & 0xF)
+#define EVENT_STATE_PATTERN(x) (((x) >> 4) & 0x7)
+
+// Built-in patterns, as numbered by the pattern select and event state
+// registers; selecting PATTERN_SWITCH acts like a press of the pushbutton
+#define PATTERN_SWITCH 0
+#define PATTERN_SHIFT_RIGHT 1
+#define PATTERN_SHIFT_LEFT 2
+#define PATTERN_COUNT_UP 3
+#define PATTERN_COUNT_DOWN 4
+#define PATTERN_CUSTOM 5
+#define PATTERN_COUNT 6
+
+// Capability register fields: LED count, and log2 of the pattern table size
+// NOTE: Hardware without a capability register reads zero here, and has 8 LEDs
+#define CAP_LED_WIDTH(x) ((x) & 0xFFFF)
+#define CAP_TABLE_BITS(x) (((x) >> 16) & 0xFF)
+#define LEGACY_LED_WIDTH 8
+// Capability feature flags
+#define CAP_TIMESTAMPS 0x01000000
+#define CAP_FIFO 0x02000000
+#define CAP_PATTERN_SELECT 0x04000000
+#define CAP_BASE_PERIOD 0x08000000
+#define CAP_PWM 0x10000000
+
+// 64-bit values (the cycle counter and write timestamps) are split into
+// low/high word pairs. Reading a low word latches its high word, which the
+// next read of any high word returns, so always read low then high.
+// Write timestamp window; slot n holds the cycle count of the last write to
+// register word n (LED window writes count as writes to REG1)
+#define WRITE_STAMP_OFFSET 0x100
+#define WRITE_STAMP_REGS 23
+#define WRITE_STAMP_LO_OFFSET(n) (WRITE_STAMP_OFFSET + (n) * 0x8)
+#define WRITE_STAMP_HI_OFFSET(n) (WRITE_STAMP_LO_OFFSET(n) + 0x4)
+
+// LED_reg window; word n holds LEDs 32n to 32n + 31, and word 0 is aliased by
+// REG1_LED_REG_OFFSET
+#define LED_WINDOW_OFFSET 0x200
+#define LED_WINDOW_WORDS 128
+#define LED_WINDOW_WORD_OFFSET(n) (LED_WINDOW_OFFSET + (n) * 0x4)
+// Offset of LED word n, using REG1 for the first (which works on all hardware)
+#define LED_WORD_OFFSET(n) ((n) ? LED_WINDOW_WORD_OFFSET(n) : REG1_LED_REG_OFFSET)
+
+// Write FIFO control register bits (run on read and write, flush on write)
+#define FIFO_CONTROL_RUN 0x1
+#define FIFO_CONTROL_FLUSH 0x2
+
+// Write FIFO status register bits; underflow and overflow are sticky, and
+// cleared by writing them back as ones
+#define FIFO_STATUS_EMPTY 0x1
+#define FIFO_STATUS_LOW 0x2
+#define FIFO_STATUS_FULL 0x4
+#define FIFO_STATUS_UNDERFLOW 0x8
+#define FIFO_STATUS_OVERFLOW 0x10
+
+// Write FIFO push window; each entry is an LED value (for up to the first 32
+// LEDs) written to an even word, then a hold time (in clock cycles) written
+// to the next word, which pushes the pair. Any even word may start an entry.
+#define FIFO_PUSH_OFFSET 0x1C0
+#define FIFO_PUSH_WORDS 16
+
+// Pattern table window; each entry holds an LED value (for up to the first 32
+// LEDs) and then a duration (in Base_rate ticks), one 32-bit word each
+#define PATTERN_TABLE_OFFSET 0x400
+#define PATTERN_TABLE_ENTRIES 128
+#define PATTERN_TABLE_ENTRY_SIZE 0x8
+#define PATTERN_TABLE_LED_OFFSET(n) (PATTERN_TABLE_OFFSET + (n) * PATTERN_TABLE_ENTRY_SIZE)
+#define PATTERN_TABLE_DURATION_OFFSET(n) (PATTERN_TABLE_LED_OFFSET(n) + 0x4)
+
+// PWM brightness window; byte n of each word sets the brightness of LED
+// 4 * (word) + n, for up to the first 1024 LEDs. Every byte lane is honoured,
+// so byte writes change one LED alone.
+#define BRIGHTNESS_OFFSET 0x800
+#define BRIGHTNESS_LEDS 1024
+#define BRIGHTNESS_WORD_OFFSET(n) (BRIGHTNESS_OFFSET + ((n) / 4) * 0x4)
+
+// Gamma table; entry n (one per word) is the duty cycle, out of 255, shown
+// for brightness n
+#define GAMMA_TABLE_OFFSET 0xC00
+#define GAMMA_TABLE_ENTRIES 256
+#define GAMMA_ENTRY_OFFSET(n) (GAMMA_TABLE_OFFSET + (n) * 0x4)
 
 // Memory span of all registers (used or not) in the component hps_led_patterns
-#define SPAN 0x10
+#define SPAN 0x1000
 
 #endif
@@ -4,23 +4,51 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <inttypes.h>
 #include <signal.h>
 #include <argp.h>
 #include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
 #include <unistd.h>
 #include <sys/mman.h>
 #include <time.h>
 
+#include "cosim_client.h"
+
 
 // Configuration values
-#define MAX_STEPS 32
+#define MAX_STEPS 128
 #define LINE_LEN 20
+#define NSEC_PER_SEC ((int64_t)1000000000)
+#define NSEC_PER_MSEC ((int64_t)1000000)
+#define DEFAULT_SPIN_USEC 500
+#define RING_SIZE 256  // Streamed steps buffered ahead of playback; a power of two
+#define STREAM_POLL_USEC 1000
 // Hardware memory addresses
 #define BRIDGE_BASE_ADDR 0xFF200000
 #define BLOCK_BASE_ADDR (BRIDGE_BASE_ADDR + 0x00000000)
-#define NUM_REGS 4
+#define NUM_REGS 23
 #define OVERRIDE_REG 0
 #define PATTERN_REG 1
+#define BASE_RATE_REG 2
+#define PLAYER_CONTROL_REG 3
+#define CAPABILITIES_REG 12
+#define CLOCK_FREQ_REG 15
+#define PATTERN_SELECT_REG 21
+#define BASE_PERIOD_REG 22
+// Capability register fields (see src/driver/reg_offsets.h)
+#define CAP_LED_WIDTH(x) ((x) & 0xFFFF)
+#define CAP_PATTERN_SELECT 0x04000000
+#define CAP_BASE_PERIOD 0x08000000
+#define LEGACY_LED_WIDTH 8
+// Player control register bits (start/stop on write, busy on read)
+#define PLAYER_CONTROL_START 0x1
+#define PLAYER_CONTROL_STOP 0x2
+#define PLAYER_CONTROL_BUSY 0x1
+#define DE10_NANO_CLOCK_FREQ 50000000
 
 // Helper macros to allow stringizing other macro values
 #define xstr(a) str(a)
@@ -42,6 +70,13 @@ static struct argp_option options[] = {
     {"no-loop", 'n', 0,                0, "display the pattern for one cycle", 0},
     {"pattern", 'p', "BIN TIME [...]", 0, "specify a sequence of pattern steps", 1},
     {"file",    'f', "FILE",           0, "specify a file containing pattern steps", 1},
+    {"stream",  'i', "FILE",           0, "play pattern steps as they are read from FILE (\"-\" for stdin, or a named pipe), until it ends", 1},
+    {"epoch",   'e', "SECONDS",        0, "align step boundaries to a shared epoch, in seconds on the sync clock (e.g. from `date +%s.%N`); late starters join at the current step", 2},
+    {"clock",   'c', "CLOCK",          0, "sync clock: realtime (default) or tai", 2},
+    {"spin",    's', "USEC",           0, "busy-wait this long before each synchronized or streamed step boundary (default " xstr(DEFAULT_SPIN_USEC) ")", 2},
+    {"no-offload", 'o', 0,             0, "always step patterns in software, even when a built-in hardware pattern matches", 1},
+    {"dry-run", 'd', 0,                0, "don't touch the hardware; print each step, and when it was displayed, instead", 3},
+    {"sim",     'm', "SOCKET",         OPTION_ARG_OPTIONAL, "drive a co-simulation of the hardware (led-patterns/cosim) instead, through SOCKET (default " COSIM_DEFAULT_SOCKET ")", 3},
     {0}
 };
 static error_t parse_opt(int, char *, struct argp_state *);
@@ -52,14 +87,50 @@ struct arguments {
         unsigned int delays[MAX_STEPS];
         bool loop;
     } pattern;
+    struct {
+        bool enabled;
+        clockid_t clock;
+        int64_t epoch;  // Nanoseconds on the sync clock
+        int64_t spin;   // Nanoseconds
+    } sync;
     char *file;
+    char *stream;
+    char *sim;
     bool verbose;
     bool loop_override;
+    bool no_offload;
+    bool dry_run;
 };
 // Final parser setup
 static struct argp argp = {options, parse_opt, 0, doc};
 
 
+// Parse a time in seconds, with up to nine fractional digits, into nanoseconds
+static int parse_seconds(const char *str, int64_t *ns) {
+    char *end;
+    errno = 0;
+    long long sec = strtoll(str, &end, 10);
+    if (errno || end == str) {
+        return 1;
+    }
+    int64_t frac = 0;
+    int64_t scale = NSEC_PER_SEC;
+    if (*end == '.') {
+        for (end++; *end >= '0' && *end <= '9'; end++) {
+            if (scale > 1) {
+                scale /= 10;
+                frac += (*end - '0') * scale;
+            }
+        }
+    }
+    if (*end != '\0') {
+        return 1;
+    }
+    *ns = sec * NSEC_PER_SEC + (str[0] == '-' ? -frac : frac);
+    return 0;
+}
+
+
 // Argument parsing logic
 static error_t parse_opt(int key, char *arg, struct argp_state *state) {
     struct arguments *arguments = state->input;
@@ -90,7 +161,7 @@ static error_t parse_opt(int key, char *arg, struct argp_state *state) {
             break;
         case 'p':
             // pattern literal series
-            if (arguments->file) {
+            if (arguments->file || arguments->stream) {
                 fputs("Pattern file already specified; pattern sequence not allowed!\n", stderr);
                 return 1;
             } else {
@@ -117,7 +188,7 @@ static error_t parse_opt(int key, char *arg, struct argp_state *state) {
             break;
         case 'f':
             // pattern file
-            if (arguments->pattern.num_steps) {
+            if (arguments->pattern.num_steps || arguments->stream) {
                 fputs("Pattern sequence already specified; pattern file not allowed!\n", stderr);
                 return 1;
             } else {
@@ -129,6 +200,50 @@ static error_t parse_opt(int key, char *arg, struct argp_state *state) {
                 arguments->file = arg;
             }
             break;
+        case 'i':
+            // pattern stream
+            if (arguments->pattern.num_steps || arguments->file) {
+                fputs("Pattern sequence already specified; pattern stream not allowed!\n", stderr);
+                return 1;
+            } else {
+                // Store (pointer to) filename
+                arguments->stream = arg;
+            }
+            break;
+
+        case 'e':
+            // shared epoch
+            if (parse_seconds(arg, &arguments->sync.epoch)) {
+                argp_error(state, "invalid epoch \"%s\"", arg);
+            }
+            arguments->sync.enabled = true;
+            break;
+        case 'c':
+            // sync clock
+            if (strcmp(arg, "realtime") == 0) {
+                arguments->sync.clock = CLOCK_REALTIME;
+            } else if (strcmp(arg, "tai") == 0) {
+                arguments->sync.clock = CLOCK_TAI;
+            } else {
+                argp_error(state, "unknown clock \"%s\"", arg);
+            }
+            break;
+        case 's':
+            // spin time before step boundaries
+            arguments->sync.spin = strtol(arg, NULL, 0) * 1000;
+            break;
+        case 'o':
+            // software stepping only
+            arguments->no_offload = true;
+            break;
+        case 'd':
+            // dry run
+            arguments->dry_run = true;
+            break;
+        case 'm':
+            // co-simulation
+            arguments->sim = arg ? arg : COSIM_DEFAULT_SOCKET;
+            break;
 
         default:
             // Unknown option
@@ -167,19 +282,49 @@ int load_pattern_file(struct arguments *arguments) {
 }
 
 
+// Co-simulation connection, used instead of the mapping when open
+static int sim_fd = -1;
+
 // Hardware memory writing
+// NOTE: Does nothing without a mapping (i.e. for a dry run)
 int write_mem(void *map_base, unsigned int reg, uint32_t data) {
+    if (map_base == NULL && sim_fd == -1) {
+        return 0;
+    }
     // Ensure target register is in range
     if (reg >= NUM_REGS) {
         fprintf(stderr, "Cannot write to device register %d (only " xstr(NUM_REGS) " mapped)\n", reg);
         return 1;
     }
-    // Write to the appropriate memory word
-    void *virt_addr = map_base + (sizeof(long) * reg);
-    *((unsigned long *) virt_addr) = data;
+    if (sim_fd != -1) {
+        if (cosim_write(sim_fd, 4 * reg, data)) {
+            fputs("Lost the co-simulation connection\n", stderr);
+            exit(1);
+        }
+        return 0;
+    }
+    // Write to the appropriate (32-bit) memory word
+    ((volatile uint32_t *) map_base)[reg] = data;
     return 0;
 }
 
+// Hardware memory reading
+// NOTE: Reads zero without a mapping (i.e. for a dry run)
+uint32_t read_mem(void *map_base, unsigned int reg) {
+    if ((map_base == NULL && sim_fd == -1) || reg >= NUM_REGS) {
+        return 0;
+    }
+    if (sim_fd != -1) {
+        uint32_t data;
+        if (cosim_read(sim_fd, 4 * reg, &data)) {
+            fputs("Lost the co-simulation connection\n", stderr);
+            exit(1);
+        }
+        return data;
+    }
+    return ((volatile uint32_t *) map_base)[reg];
+}
+
 
 // Interrupt flag setup and handling
 static volatile sig_atomic_t interrupted = 0;
@@ -190,77 +335,588 @@ static void sig_handler(int _) {
 }
 
 
+// Synchronized playback
+// Steps are laid out on a timeline starting at the epoch and repeating every
+// pattern period, so any instance can work out which step is current from the
+// clock alone. Each boundary is slept to as an absolute deadline, recomputed
+// from the epoch every step, so timing errors never accumulate and clock
+// adjustments (e.g. NTP slewing) are followed automatically.
+
+// Read a clock, in nanoseconds
+static int64_t clock_ns(clockid_t clock) {
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+}
+
+// Sleep until an absolute deadline; the last `spin` nanoseconds are busy-waited,
+// since waking from a sleep takes an unpredictable (and often longer) time
+// NOTE: The spin yields the CPU on each pass, so several instances sharing a
+// core (as in a local test) take turns instead of starving each other
+static void sleep_until(clockid_t clock, int64_t deadline, int64_t spin) {
+    int64_t wake = deadline - spin;
+    struct timespec ts = {wake / NSEC_PER_SEC, wake % NSEC_PER_SEC};
+    while (clock_nanosleep(clock, TIMER_ABSTIME, &ts, NULL) == EINTR && !interrupted) {
+        // Sleep again if woken early by a signal other than SIGINT
+    }
+    while (!interrupted && clock_ns(clock) < deadline) {
+        sched_yield();
+    }
+}
+
+// Find the step on display at time `now`, and when it ends
+// Returns the number of whole pattern periods since the epoch (negative
+// before it, in which case the first step is due at the epoch)
+static int64_t locate_step(const struct arguments *arguments, int64_t period,
+        int64_t now, unsigned int *step, int64_t *step_end) {
+    int64_t elapsed = now - arguments->sync.epoch;
+    if (elapsed < 0) {
+        *step = 0;
+        *step_end = arguments->sync.epoch;
+        return -1;
+    }
+    int64_t cycle = elapsed / period;
+    int64_t offset = elapsed % period;
+    int64_t end = 0;
+    unsigned int i;
+    for (i = 0; i < arguments->pattern.num_steps - 1; i++) {
+        end += arguments->pattern.delays[i] * NSEC_PER_MSEC;
+        if (offset < end) {
+            break;
+        }
+    }
+    if (i == arguments->pattern.num_steps - 1) {
+        end = period;
+    }
+    *step = i;
+    *step_end = arguments->sync.epoch + cycle * period + end;
+    return cycle;
+}
+
+// Display pattern steps in lockstep with the shared epoch, until interrupted
+// or (when not looping) the first pattern period after the epoch is over
+int play_synchronized(void *map_base, const struct arguments *arguments) {
+    clockid_t clock = arguments->sync.clock;
+    int64_t period = 0;
+    for (unsigned int i = 0; i < arguments->pattern.num_steps; i++) {
+        period += arguments->pattern.delays[i] * NSEC_PER_MSEC;
+    }
+    if (period <= 0) {
+        fputs("Synchronized playback needs a pattern period longer than zero\n", stderr);
+        return 1;
+    }
+
+    unsigned int step;
+    int64_t step_end;
+    int64_t cycle = locate_step(arguments, period, clock_ns(clock), &step, &step_end);
+    if (cycle < 0) {
+        // Wait for the epoch
+        sleep_until(clock, step_end, arguments->sync.spin);
+    }
+    while (!interrupted) {
+        int64_t due = step_end;
+        cycle = locate_step(arguments, period, clock_ns(clock), &step, &step_end);
+        if (cycle > 0 && !arguments->pattern.loop) {
+            break;
+        }
+        write_mem(map_base, PATTERN_REG, arguments->pattern.steps[step]);
+        int64_t now = clock_ns(clock);
+
+        if (arguments->dry_run) {
+            // Report when the step was displayed, and how late that was
+            // relative to its boundary (for a late joiner, the first step
+            // is "late" by however far into it we joined)
+            printf("%" PRId64 ".%09" PRId64 " cycle %" PRId64 " step %u 0x%08X late %" PRId64 " ns\n",
+                   now / NSEC_PER_SEC, now % NSEC_PER_SEC, cycle, step,
+                   arguments->pattern.steps[step], now - due);
+        } else if (arguments->verbose) {
+            printf("Displaying pattern step 0x%08X (cycle %" PRId64 ", step %u), %" PRId64 " ns late\n",
+                   arguments->pattern.steps[step], cycle, step, now - due);
+        }
+        sleep_until(clock, step_end, arguments->sync.spin);
+    }
+    return 0;
+}
+
+
+// Hardware offload planning
+// Each built-in pattern core in LED_Patterns steps once every CLK_SCALES(N)
+// fine ticks, i.e. every Base_rate * CLK_SCALES(N) / 256 seconds (both UQ4.4),
+// or every Base_period * CLK_SCALES(N) / 16 clock cycles where supported.
+// A looping pattern whose steps all last as long, and which runs through the
+// same cycle of values as a core does, can be left entirely to the hardware.
+// NOTE: Keep these in step with led-patterns/led_patterns.vhd
+enum hw_pattern {HW_SHIFT_RIGHT = 1, HW_SHIFT_LEFT, HW_COUNT_UP, HW_COUNT_DOWN, HW_CUSTOM, HW_PATTERNS};
+static const char *hw_pattern_names[HW_PATTERNS] = {
+    [HW_SHIFT_RIGHT] = "SHIFT_RIGHT",
+    [HW_SHIFT_LEFT] = "SHIFT_LEFT",
+    [HW_COUNT_UP] = "COUNT_UP",
+    [HW_COUNT_DOWN] = "COUNT_DOWN",
+    [HW_CUSTOM] = "CUSTOM",
+};
+static const unsigned int hw_pattern_scales[HW_PATTERNS] = {
+    [HW_SHIFT_RIGHT] = 0x08,
+    [HW_SHIFT_LEFT] = 0x04,
+    [HW_COUNT_UP] = 0x20,
+    [HW_COUNT_DOWN] = 0x02,
+    [HW_CUSTOM] = 0x01,
+};
+
+struct offload {
+    enum hw_pattern pattern;
+    uint8_t base_rate;     // UQ4.4 seconds
+    uint32_t base_period;  // Clock cycles, used instead of base_rate if nonzero
+};
+
+// Compute one full cycle of a pattern core's output, for `width` pattern LEDs
+// Returns the cycle length, or 0 if it would exceed `max` steps
+static unsigned int hw_pattern_cycle(enum hw_pattern pattern, unsigned int width,
+        uint32_t *values, unsigned int max) {
+    uint32_t mask = (width < 32) ? (1u << width) - 1 : UINT32_MAX;
+    unsigned int length;
+    switch (pattern) {
+        case HW_SHIFT_RIGHT:
+        case HW_SHIFT_LEFT:
+            // One (or two) LEDs rotating around the pattern
+            length = width;
+            if (width >= 32 || length > max) {
+                return 0;
+            }
+            for (unsigned int i = 0; i < length; i++) {
+                values[i] = (pattern == HW_SHIFT_RIGHT)
+                    ? (1u << (width - 1)) >> i
+                    : ((3u << i) | (3u >> (width - i))) & mask;
+            }
+            return length;
+        case HW_COUNT_UP:
+        case HW_COUNT_DOWN:
+            if (width >= 32 || (1u << width) > max) {
+                return 0;
+            }
+            length = 1u << width;
+            for (unsigned int i = 0; i < length; i++) {
+                values[i] = (pattern == HW_COUNT_UP) ? i : mask - i;
+            }
+            return length;
+        case HW_CUSTOM: {
+            // KITT chaser: a pair of LEDs bouncing between the ends of a
+            // generator one LED wider than the display on each side
+            length = 2 * width;
+            if (width + 2 > 32 || length > max) {
+                return 0;
+            }
+            uint64_t state = 3;
+            bool forward = false;
+            for (unsigned int i = 0; i < length; i++) {
+                values[i] = (state >> 1) & mask;
+                if (state & (1ull << (width + 1))) {
+                    forward = true;
+                } else if (state & 1) {
+                    forward = false;
+                }
+                state = forward ? (state >> 1) | ((state & 1) << (width + 1))
+                                : ((state << 1) | (state >> (width + 1))) & ((1ull << (width + 2)) - 1);
+            }
+            return length;
+        }
+        default:
+            return 0;
+    }
+}
+
+// Check whether `steps` is a rotation of `cycle` (both `length` long)
+static bool is_rotation(const unsigned int *steps, const uint32_t *cycle, unsigned int length) {
+    for (unsigned int start = 0; start < length; start++) {
+        unsigned int i;
+        for (i = 0; i < length && steps[i] == cycle[(start + i) % length]; i++) {
+        }
+        if (i == length) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Find a built-in pattern core, and Base_rate or Base_period, that reproduce
+// the requested pattern on every LED below the top one; `led_width` includes
+// that top (heartbeat) LED, which the pattern must leave off, but which blinks
+// regardless while a built-in pattern runs, and `clock_freq` is 0 if the
+// hardware has no Base_period register
+static bool plan_offload(const struct arguments *arguments, unsigned int led_width,
+        uint32_t clock_freq, struct offload *plan) {
+    unsigned int num_steps = arguments->pattern.num_steps;
+    unsigned int width = led_width - 1;
+    // Steps only cover LED_reg's first word, so wider cores can't match
+    if (!arguments->pattern.loop || num_steps == 0 || width >= 32) {
+        return false;
+    }
+    unsigned int delay = arguments->pattern.delays[0];
+    for (unsigned int i = 0; i < num_steps; i++) {
+        if (arguments->pattern.delays[i] != delay
+                || (width < 32 && arguments->pattern.steps[i] >> width)) {
+            return false;
+        }
+    }
+    for (enum hw_pattern pattern = HW_SHIFT_RIGHT; pattern < HW_PATTERNS; pattern++) {
+        uint32_t cycle[MAX_STEPS];
+        if (hw_pattern_cycle(pattern, width, cycle, MAX_STEPS) != num_steps
+                || !is_rotation(arguments->pattern.steps, cycle, num_steps)) {
+            continue;
+        }
+        // Steps last Base_rate * scale / 256 seconds, so the delay needs an
+        // exact, nonzero UQ4.4 Base_rate of delay * 256 / (1000 * scale)
+        uint64_t numerator = (uint64_t)delay * 256;
+        uint64_t denominator = 1000 * hw_pattern_scales[pattern];
+        if (numerator % denominator == 0 && numerator / denominator != 0
+                && numerator / denominator <= UINT8_MAX) {
+            plan->pattern = pattern;
+            plan->base_rate = numerator / denominator;
+            plan->base_period = 0;
+            return true;
+        }
+        // Otherwise, steps last Base_period * scale / 16 cycles, so the
+        // delay needs a Base_period of delay * clock_freq * 16 / (1000 * scale)
+        numerator = (uint64_t)delay * clock_freq * 16;
+        if (numerator % denominator == 0 && numerator / denominator != 0
+                && numerator / denominator <= UINT32_MAX) {
+            plan->pattern = pattern;
+            plan->base_rate = 0;
+            plan->base_period = numerator / denominator;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Let a built-in pattern core display the pattern, until interrupted
+// The pattern player outranks the built-in patterns, so it is stopped
+// meanwhile (such as after the driver preloads a table), and restarted after;
+// the pattern that was selected is put back too
+int play_offloaded(void *map_base, const struct offload *plan) {
+    uint32_t old_pattern = read_mem(map_base, PATTERN_SELECT_REG);
+    uint32_t old_rate = read_mem(map_base, BASE_RATE_REG);
+    uint32_t old_period = plan->base_period ? read_mem(map_base, BASE_PERIOD_REG) : 0;
+    bool player_was_busy = read_mem(map_base, PLAYER_CONTROL_REG) & PLAYER_CONTROL_BUSY;
+    if (player_was_busy) {
+        write_mem(map_base, PLAYER_CONTROL_REG, PLAYER_CONTROL_STOP);
+    }
+    if (plan->base_period) {
+        write_mem(map_base, BASE_PERIOD_REG, plan->base_period);
+    } else {
+        // NOTE: This also clears Base_period, on hardware that has it
+        write_mem(map_base, BASE_RATE_REG, plan->base_rate);
+    }
+    write_mem(map_base, PATTERN_SELECT_REG, plan->pattern);
+    write_mem(map_base, OVERRIDE_REG, false);
+    // Nothing left to do but wait (without racing the signal handler)
+    sigset_t sigint, old_mask;
+    sigemptyset(&sigint);
+    sigaddset(&sigint, SIGINT);
+    sigprocmask(SIG_BLOCK, &sigint, &old_mask);
+    while (!interrupted) {
+        sigsuspend(&old_mask);
+    }
+    sigprocmask(SIG_SETMASK, &old_mask, NULL);
+    // Writing Base_rate clears Base_period, so restore that afterwards
+    write_mem(map_base, BASE_RATE_REG, old_rate);
+    if (old_period) {
+        write_mem(map_base, BASE_PERIOD_REG, old_period);
+    }
+    // Reads give 0 while the switches pick the pattern, and writing 0 goes
+    // back to them, just as a pushbutton press would
+    write_mem(map_base, PATTERN_SELECT_REG, old_pattern);
+    // The player restarts from Player_first, with its table and loop setting
+    // as they were
+    if (player_was_busy) {
+        write_mem(map_base, PLAYER_CONTROL_REG, PLAYER_CONTROL_START);
+    }
+    return 0;
+}
+
+
+// Streaming playback
+// A loader thread reads steps from the stream, and hands them to the playback
+// (main) thread through a preallocated single-producer/single-consumer ring,
+// so playback never waits on I/O or memory allocation. Each index is written
+// by one side only, so no locks are needed: the loader publishes a slot by
+// advancing `head` after filling it, and the player frees one by advancing
+// `tail` after reading it.
+// Backpressure: while the ring is full, the loader stops reading, so a writer
+// on the other end of a pipe blocks once the pipe fills up too.
+// Underrun: if no step is ready as one ends, the LEDs keep showing it. The
+// next step to arrive is displayed at once, and timing restarts from there.
+struct step {
+    uint32_t value;
+    uint32_t delay;  // Milliseconds
+};
+static struct {
+    struct step slots[RING_SIZE];
+    // Keep each index on its own cache line, so the threads don't contend
+    size_t head __attribute__((aligned(64)));  // Next slot to fill
+    size_t tail __attribute__((aligned(64)));  // Next slot to play
+    bool done;  // Set by the loader once the stream has ended
+} ring;
+
+// Add a step to the ring, unless it's full (loader only)
+static bool ring_push(const struct step *step) {
+    size_t head = __atomic_load_n(&ring.head, __ATOMIC_RELAXED);
+    if (head - __atomic_load_n(&ring.tail, __ATOMIC_ACQUIRE) == RING_SIZE) {
+        return false;
+    }
+    ring.slots[head % RING_SIZE] = *step;
+    __atomic_store_n(&ring.head, head + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+// Take the next step from the ring, unless it's empty (player only)
+static bool ring_pop(struct step *step) {
+    size_t tail = __atomic_load_n(&ring.tail, __ATOMIC_RELAXED);
+    if (__atomic_load_n(&ring.head, __ATOMIC_ACQUIRE) == tail) {
+        return false;
+    }
+    *step = ring.slots[tail % RING_SIZE];
+    __atomic_store_n(&ring.tail, tail + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+// Loader thread: parse steps from the stream into the ring, until it ends
+static void *load_stream(void *arg) {
+    FILE *fin = arg;
+    const struct timespec poll = {0, STREAM_POLL_USEC * 1000};
+    // Lines may be any length, and only the loader ever waits on the
+    // allocation; one that ends without a newline was cut short
+    char *line = NULL;
+    size_t line_size = 0;
+    ssize_t len;
+    while ((len = getline(&line, &line_size, fin)) != -1) {
+        struct step step;
+        bool complete = len > 0 && line[len - 1] == '\n';
+        if (!complete || sscanf(line, "%X %u", &step.value, &step.delay) != 2) {
+            line[strcspn(line, "\n")] = '\0';
+            fprintf(stderr, "Ignoring %s pattern step \"%s\"\n",
+                    complete ? "malformed" : "unterminated", line);
+            continue;
+        }
+        while (!ring_push(&step)) {
+            // Ring full; wait for the player to catch up
+            nanosleep(&poll, NULL);
+        }
+    }
+    free(line);
+    __atomic_store_n(&ring.done, true, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+// Display pattern steps from a stream as they arrive, until interrupted or
+// the stream ends
+int play_stream(void *map_base, const struct arguments *arguments, FILE *fin) {
+    // Keep SIGINT off the loader, so it interrupts the player's sleeps
+    sigset_t sigint, old_mask;
+    sigemptyset(&sigint);
+    sigaddset(&sigint, SIGINT);
+    pthread_sigmask(SIG_BLOCK, &sigint, &old_mask);
+    pthread_t loader;
+    int err = pthread_create(&loader, NULL, load_stream, fin);
+    pthread_sigmask(SIG_SETMASK, &old_mask, NULL);
+    if (err) {
+        fprintf(stderr, "Failed to start stream loader: %s\n", strerror(err));
+        return 1;
+    }
+
+    const clockid_t clock = CLOCK_MONOTONIC;
+    const struct timespec poll = {0, STREAM_POLL_USEC * 1000};
+    int64_t deadline = 0;
+    unsigned long underruns = 0;
+    bool started = false;
+    bool waiting = true;
+    while (!interrupted) {
+        // Check for the end of the stream first, so no step pushed before it
+        // is missed
+        bool done = __atomic_load_n(&ring.done, __ATOMIC_ACQUIRE);
+        struct step step;
+        if (!ring_pop(&step)) {
+            if (done) {
+                break;
+            }
+            if (!waiting && started) {
+                underruns++;
+                if (arguments->verbose || arguments->dry_run) {
+                    puts("Stream underrun; holding the last pattern step");
+                }
+            }
+            waiting = true;
+            nanosleep(&poll, NULL);
+            continue;
+        }
+        // After waiting for a step, time it from its arrival
+        if (waiting) {
+            deadline = clock_ns(clock);
+            waiting = false;
+        }
+        started = true;
+
+        write_mem(map_base, PATTERN_REG, step.value);
+        if (arguments->verbose || arguments->dry_run) {
+            printf("Displaying pattern step 0x%08X for %u ms\n", step.value, step.delay);
+        }
+        deadline += step.delay * NSEC_PER_MSEC;
+        sleep_until(clock, deadline, arguments->sync.spin);
+    }
+
+    // The loader may still be blocked reading; it can be cancelled there
+    pthread_cancel(loader);
+    pthread_join(loader, NULL);
+    if (underruns) {
+        fprintf(stderr, "%lu stream underrun(s)\n", underruns);
+    }
+    return 0;
+}
+
+
 int main(int argc, char **argv) {
     // Register interrupt handler
     signal(SIGINT, sig_handler);
 
     // Parse arguments
     struct arguments params = {
-        {0},  // Empty pattern struct
-        NULL, // Empty filepath
-        false // Not verbose
+        .pattern = {0},         // Empty pattern struct
+        .sync = {
+            .enabled = false,   // Free-running playback
+            .clock = CLOCK_REALTIME,
+            .spin = DEFAULT_SPIN_USEC * 1000,
+        },
+        .file = NULL,           // Empty filepath
+        .stream = NULL,         // Not streaming
+        .verbose = false        // Not verbose
     };
     argp_parse(&argp, argc, argv, ARGP_NO_HELP, 0, &params);
     // Load patterns from file, if provided
     if (params.file) {
         load_pattern_file(&params);
     }
-    // Ensure that patterns are present
-    if (params.pattern.num_steps == 0) {
+    // Open the pattern stream, if provided
+    FILE *stream = NULL;
+    if (params.stream) {
+        if (params.sync.enabled) {
+            fputs("Streamed patterns can't be synchronized to an epoch\n", stderr);
+            return 1;
+        }
+        stream = strcmp(params.stream, "-") == 0 ? stdin : fopen(params.stream, "r");
+        if (stream == NULL) {
+            fprintf(stderr, "Failed to open input stream \"%s\"\n", params.stream);
+            return 1;
+        }
+    }
+    // Ensure that patterns are present, unless they're being streamed in
+    if (!stream && params.pattern.num_steps == 0) {
         fputs("No patterns loaded! Provide a pattern sequence or a valid pattern file.\n", stderr);
         return 1;
     }
 
     int exitcode = 0;
-    // Prepare /dev/mem for writing
-    int mem = open("/dev/mem", O_RDWR | O_SYNC);
-    if (mem == -1) {
-        printf("Failed to open /dev/mem for writing. Are you root?\n");
-        exitcode = 1;
-    } else {
-        long map_size = 4 * NUM_REGS;
-        void *map_base = mmap(0, map_size, PROT_WRITE, MAP_SHARED, mem, BLOCK_BASE_ADDR);
+    int mem = -1;
+    long map_size = 4 * NUM_REGS;
+    void *map_base = NULL;
+    // Prepare /dev/mem for writing, unless this is a dry run or co-simulation
+    if (params.sim) {
+        if (params.dry_run) {
+            fputs("A dry run can't drive a co-simulation\n", stderr);
+            return 1;
+        }
+        sim_fd = cosim_connect(params.sim);
+        if (sim_fd == -1) {
+            fprintf(stderr, "Failed to connect to co-simulation at \"%s\"\n", params.sim);
+            return 1;
+        }
+    } else if (!params.dry_run) {
+        mem = open("/dev/mem", O_RDWR | O_SYNC);
+        if (mem == -1) {
+            printf("Failed to open /dev/mem for writing. Are you root?\n");
+            return 1;
+        }
+        map_base = mmap(0, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, mem, BLOCK_BASE_ADDR);
         if (map_base == (void *) -1) {
             printf("Failed to map memory\n");
-            exitcode = 1;
+            close(mem);
+            return 1;
+        }
+    }
+
+    // Hand the pattern to the hardware if it has a matching built-in pattern,
+    // assuming the DE10-Nano's LEDs and clock for a dry run
+    struct offload plan;
+    bool offload = false;
+    if (!stream && !params.sync.enabled && !params.no_offload) {
+        uint32_t caps = read_mem(map_base, CAPABILITIES_REG);
+        if (params.dry_run) {
+            offload = plan_offload(&params, LEGACY_LED_WIDTH, DE10_NANO_CLOCK_FREQ, &plan);
+        } else if (caps & CAP_PATTERN_SELECT) {
+            uint32_t clock_freq = (caps & CAP_BASE_PERIOD) ? read_mem(map_base, CLOCK_FREQ_REG) : 0;
+            offload = plan_offload(&params, CAP_LED_WIDTH(caps), clock_freq, &plan);
+        }
+    }
+    if (offload && (params.verbose || params.dry_run)) {
+        if (plan.base_period) {
+            printf("Offloading to built-in pattern %s, with Base_period %u cycles\n",
+                   hw_pattern_names[plan.pattern], plan.base_period);
         } else {
+            printf("Offloading to built-in pattern %s, with Base_rate 0x%02X\n",
+                   hw_pattern_names[plan.pattern], plan.base_rate);
+        }
+        printf("The top LED blinks as a heartbeat meanwhile; use --no-offload to keep it off\n");
+    }
 
-            unsigned int step = 0;
-            struct timespec ts = {0};
-            // Enable pattern override
-            write_mem(map_base, OVERRIDE_REG, true);
-            // Display pattern steps in sequence until interrupted
-            while (!interrupted) {
-
-                // Convert millisecond input to timespec
-                ts.tv_sec = params.pattern.delays[step] / 1000; // Integer division is intended here
-                ts.tv_nsec = (params.pattern.delays[step] % 1000) * 1000000;
-                // Display pattern and sleep
-                if (params.verbose) {
-                    printf("Displaying pattern step 0x%08X for %d ms\n", params.pattern.steps[step], params.pattern.delays[step]);
-                }
-                write_mem(map_base, PATTERN_REG, params.pattern.steps[step]);
-                nanosleep(&ts, NULL);
-
-                // Increment or wrap step counter, as appropriate
-                if (step >= params.pattern.num_steps - 1) {
-                    // Wrap step counter, or exit if not looping
-                    if (params.pattern.loop) {
-                        step = 0;
-                    } else {
-                        break;
-                    }
+    // Enable pattern override
+    write_mem(map_base, OVERRIDE_REG, true);
+    if (offload) {
+        exitcode = params.dry_run ? 0 : play_offloaded(map_base, &plan);
+    } else if (stream) {
+        exitcode = play_stream(map_base, &params, stream);
+    } else if (params.sync.enabled) {
+        exitcode = play_synchronized(map_base, &params);
+    } else {
+        unsigned int step = 0;
+        struct timespec ts = {0};
+        // Display pattern steps in sequence until interrupted
+        while (!interrupted) {
+
+            // Convert millisecond input to timespec
+            ts.tv_sec = params.pattern.delays[step] / 1000; // Integer division is intended here
+            ts.tv_nsec = (params.pattern.delays[step] % 1000) * 1000000;
+            // Display pattern and sleep
+            if (params.verbose || params.dry_run) {
+                printf("Displaying pattern step 0x%08X for %d ms\n", params.pattern.steps[step], params.pattern.delays[step]);
+            }
+            write_mem(map_base, PATTERN_REG, params.pattern.steps[step]);
+            nanosleep(&ts, NULL);
+
+            // Increment or wrap step counter, as appropriate
+            if (step >= params.pattern.num_steps - 1) {
+                // Wrap step counter, or exit if not looping
+                if (params.pattern.loop) {
+                    step = 0;
                 } else {
-                    // Increment step counter
-                    step++;
+                    break;
                 }
-
+            } else {
+                // Increment step counter
+                step++;
             }
-            // Clean up and exit
-            write_mem(map_base, OVERRIDE_REG, false);
-            munmap(map_base, map_size);
+
         }
+    }
+
+    // Clean up and exit
+    write_mem(map_base, OVERRIDE_REG, false);
+    if (stream && stream != stdin) {
+        fclose(stream);
+    }
+    if (map_base) {
+        munmap(map_base, map_size);
         close(mem);
     }
+    if (sim_fd != -1) {
+        close(sim_fd);
+    }
     return exitcode;
 }
@@ -0,0 +1,61 @@
+#!/bin/sh
+# Test synchronized playback with several local myLEDpatterns instances
+# Each instance runs as a dry run against the same epoch, with later ones
+# joining part-way through; their step boundaries are then compared.
+# Usage: sync_test.sh [INSTANCES] [SECONDS] [extra myLEDpatterns options...]
+
+program=${PROGRAM:-./exec/x86/myLEDpatterns}
+instances=${1:-3}
+duration=${2:-5}
+[ $# -gt 0 ] && shift
+[ $# -gt 0 ] && shift
+logdir=$(mktemp -d)
+
+# Start one second from now, so the first instance is on time
+epoch=$(date +%s.%N | awk '{ printf "%.3f", $1 + 1 }')
+echo ":: Starting $instances instances against epoch $epoch..."
+i=0
+while [ $i -lt $instances ]
+do
+    (
+        # Stagger start times by 0.7 seconds, so later instances join late
+        sleep $(awk "BEGIN { print $i * 0.7 }")
+        timeout -s INT $duration "$program" --dry-run --epoch "$epoch" "$@" \
+            --pattern 0x01 50 0x02 120 0x04 30 > "$logdir/$i.log"
+    ) &
+    i=$((i + 1))
+done
+wait
+
+echo ":: Comparing step boundaries..."
+# Each log line reads: TIME cycle C step S VALUE late NS
+# A late joiner's first step starts mid-step, so it isn't a boundary; skip it.
+for log in "$logdir"/*.log
+do
+    grep ' cycle ' "$log" | tail -n +2
+done | awk -v n=$instances '
+    {
+        key = $3 " " $5
+        split($1, t, ".")
+        ns = (t[1] % 1000) * 1e9 + t[2]
+        if (!(key in lo) || ns < lo[key]) lo[key] = ns
+        if (!(key in hi) || ns > hi[key]) hi[key] = ns
+        count[key]++
+        late = $(NF - 1)
+        if (late > worst) worst = late
+    }
+    END {
+        for (key in count) {
+            if (count[key] != n) continue
+            shared++
+            spread = hi[key] - lo[key]
+            total += spread
+            if (spread > max) max = spread
+        }
+        if (!shared) { print " no step boundaries shared by all instances"; exit 1 }
+        printf " %d shared boundaries: mean spread %.1f us, max spread %.1f us\n", shared, total / shared / 1000, max / 1000
+        printf " worst lateness behind the ideal boundary: %.1f us\n", worst / 1000
+    }'
+status=$?
+rm -r "$logdir"
+exit $status